@@ -0,0 +1,143 @@
+/*
+ * RMS, VU and PPM meter ballistics
+ * Copyright (C) 2011-2026 Filipe Coelho <falktx@falktx.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * For a full copy of the GNU General Public License see the COPYING file
+ */
+
+#include "ballistics.hpp"
+
+#include <cmath>
+
+// one-pole coefficient for a time constant in seconds
+static inline
+float time_constant_coeff(const double seconds, const double sampleRate)
+{
+    return float(1.0 - std::exp(-1.0 / (seconds * sampleRate)));
+}
+
+// per-sample multiplier that falls 'decibels' over 'seconds'
+static inline
+float fall_coeff(const double decibels, const double seconds, const double sampleRate)
+{
+    return float(std::pow(10.0, -decibels / 20.0 / (seconds * sampleRate)));
+}
+
+// -------------------------------
+
+LevelBallistics::LevelBallistics()
+    : fMode(MODE_RMS),
+      fChannels(0),
+      fAttack(0.0f),
+      fRelease(0.0f),
+      fStates(nullptr),
+      fValues(nullptr) {}
+
+LevelBallistics::~LevelBallistics()
+{
+    if (fStates != nullptr)
+        delete[] fStates;
+    if (fValues != nullptr)
+        delete[] fValues;
+}
+
+void LevelBallistics::setup(const uint32_t channels, const double sampleRate, const Mode mode, const float rmsWindowMs)
+{
+    fMode = mode;
+    fChannels = channels;
+
+    switch (mode)
+    {
+    case MODE_RMS:
+        fAttack  = time_constant_coeff(rmsWindowMs / 1000.0, sampleRate);
+        fRelease = 0.0f;
+        break;
+    case MODE_VU:
+        // reach 99% of a steady tone in 300 ms
+        fAttack  = time_constant_coeff(0.3 / std::log(100.0), sampleRate);
+        fRelease = 0.0f;
+        break;
+    case MODE_PPM_TYPE_I:
+        fAttack  = time_constant_coeff(0.0032, sampleRate);
+        fRelease = fall_coeff(20.0, 1.5, sampleRate);
+        break;
+    case MODE_PPM_TYPE_II:
+        fAttack  = time_constant_coeff(0.0072, sampleRate);
+        fRelease = fall_coeff(24.0, 2.8, sampleRate);
+        break;
+    }
+
+    if (fStates != nullptr)
+        delete[] fStates;
+    if (fValues != nullptr)
+        delete[] fValues;
+
+    fStates = (channels > 0) ? new float[channels] : nullptr;
+    fValues = (channels > 0) ? new std::atomic<float>[channels] : nullptr;
+
+    for (uint32_t i=0; i < channels; ++i)
+    {
+        fStates[i] = 0.0f;
+        fValues[i].store(0.0f, std::memory_order_relaxed);
+    }
+}
+
+void LevelBallistics::process(const uint32_t channel, const float* const buffer, const uint32_t frames)
+{
+    const float attack  = fAttack;
+    const float release = fRelease;
+
+    float state = fStates[channel];
+    float value;
+
+    switch (fMode)
+    {
+    case MODE_RMS:
+        for (uint32_t i=0; i < frames; ++i)
+            state += attack * (buffer[i]*buffer[i] - state);
+        value = std::sqrt(state);
+        break;
+
+    case MODE_VU:
+        for (uint32_t i=0; i < frames; ++i)
+            state += attack * (std::fabs(buffer[i]) - state);
+        // rectified average of a sine is 2/pi of its peak, RMS is 1/sqrt(2)
+        value = state * 1.1107207f;
+        break;
+
+    case MODE_PPM_TYPE_I:
+    case MODE_PPM_TYPE_II:
+        for (uint32_t i=0; i < frames; ++i)
+        {
+            const float level = std::fabs(buffer[i]);
+
+            if (level > state)
+                state += attack * (level - state);
+            else
+                state *= release;
+        }
+        value = state;
+        break;
+
+    default:
+        value = 0.0f;
+        break;
+    }
+
+    // keep silence out of the denormal range
+    if (state < 1e-12f)
+        state = 0.0f;
+
+    fStates[channel] = state;
+    fValues[channel].store(value, std::memory_order_relaxed);
+}
@@ -0,0 +1,74 @@
+/*
+ * RMS, VU and PPM meter ballistics
+ * Copyright (C) 2011-2026 Filipe Coelho <falktx@falktx.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * For a full copy of the GNU General Public License see the COPYING file
+ */
+
+#ifndef __BALLISTICS_HPP__
+#define __BALLISTICS_HPP__
+
+#include <atomic>
+#include <stdint.h>
+
+// Sample-accurate level integrators, run per block in the RT thread.
+// The published values already include the meter's ballistics, the GUI only has to draw them,
+// so the response does not depend on how often the GUI refreshes.
+//
+// setup() allocates and must be called before processing; process() is RT-safe.
+// getValue() can be called from any thread.
+class LevelBallistics
+{
+public:
+    enum Mode {
+        MODE_RMS         = 0, // mean square over a sliding exponential window
+        MODE_VU          = 1, // 300 ms rise time, rectified average scaled to read RMS on a sine
+        MODE_PPM_TYPE_I  = 2, // DIN 45406, 5 ms burst reads -2 dB, 20 dB fall in 1.5 s
+        MODE_PPM_TYPE_II = 3  // BBC / IEC 60268-10 IIa, 10 ms burst reads -2.5 dB, 24 dB fall in 2.8 s
+    };
+
+    LevelBallistics();
+    ~LevelBallistics();
+
+    void setup(uint32_t channels, double sampleRate, Mode mode, float rmsWindowMs = 300.0f);
+
+    Mode getMode() const
+    {
+        return fMode;
+    }
+
+    // RT thread, once per period and channel
+    void process(uint32_t channel, const float* buffer, uint32_t frames);
+
+    // any thread, linear level of the channel at the end of the last processed period
+    float getValue(uint32_t channel) const
+    {
+        return fValues[channel].load(std::memory_order_relaxed);
+    }
+
+private:
+    Mode     fMode;
+    uint32_t fChannels;
+
+    float fAttack;
+    float fRelease;
+
+    // integrator state per channel, kept apart from the published values
+    float* fStates;
+    std::atomic<float>* fValues;
+
+    LevelBallistics(const LevelBallistics&);
+    LevelBallistics& operator=(const LevelBallistics&);
+};
+
+#endif // __BALLISTICS_HPP__
@@ -0,0 +1,354 @@
+/*
+ * EBU R128 / ITU-R BS.1770 loudness meter
+ * Copyright (C) 2011-2026 Filipe Coelho <falktx@falktx.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * For a full copy of the GNU General Public License see the COPYING file
+ */
+
+#include "loudness.hpp"
+
+#include <cmath>
+#include <cstring>
+
+#ifndef M_PI
+# define M_PI 3.14159265358979323846
+#endif
+
+// histogram covers -70 to +30 LUFS in 0.1 LU steps
+static const double   kHistogramMin   = -70.0;
+static const double   kHistogramStep  = 0.1;
+static const uint32_t kHistogramBins  = 1000;
+
+static const uint32_t kMomentaryBlocks = 4;
+static const uint32_t kShortTermBlocks = 30;
+
+const float LoudnessMeter::kSilence = -100.0f;
+
+// -------------------------------
+
+static inline
+double energy_to_loudness(const double energy)
+{
+    return -0.691 + 10.0 * std::log10(energy);
+}
+
+static inline
+float energy_to_published_loudness(const double energy)
+{
+    if (energy <= 0.0)
+        return LoudnessMeter::kSilence;
+
+    const double loudness = energy_to_loudness(energy);
+    return (loudness > LoudnessMeter::kSilence) ? float(loudness) : LoudnessMeter::kSilence;
+}
+
+// -------------------------------
+
+LoudnessMeter::LoudnessMeter()
+    : fChannels(0),
+      fSubBlockFrames(0),
+      fSubBlockPos(0),
+      fFilterState(nullptr),
+      fWeights(nullptr),
+      fSubBlockSum(0.0),
+      fSubBlockIndex(0),
+      fSubBlockCount(0),
+      fHistogram(nullptr),
+      fHistogramEnergies(nullptr),
+      fMomentary(kSilence),
+      fShortTerm(kSilence),
+      fIntegrated(kSilence),
+      fResetRequested(false)
+{
+    std::memset(&fShelf, 0, sizeof(Biquad));
+    std::memset(&fHighPass, 0, sizeof(Biquad));
+    std::memset(fSubBlocks, 0, sizeof(fSubBlocks));
+}
+
+LoudnessMeter::~LoudnessMeter()
+{
+    if (fFilterState != nullptr)
+        delete[] fFilterState;
+    if (fWeights != nullptr)
+        delete[] fWeights;
+    if (fHistogram != nullptr)
+        delete[] fHistogram;
+    if (fHistogramEnergies != nullptr)
+        delete[] fHistogramEnergies;
+}
+
+void LoudnessMeter::setup(const uint32_t channels, const double sampleRate)
+{
+    fChannels = channels;
+    fSubBlockFrames = uint32_t(sampleRate / 10.0 + 0.5);
+
+    // K-weighting, stage 1: high shelf, +4 dB above ~1.7 kHz
+    {
+        const double f0 = 1681.974450955533;
+        const double G  = 3.999843853973347;
+        const double Q  = 0.7071752369554196;
+
+        const double K  = std::tan(M_PI * f0 / sampleRate);
+        const double Vh = std::pow(10.0, G / 20.0);
+        const double Vb = std::pow(Vh, 0.4996667741545416);
+        const double a0 = 1.0 + K / Q + K * K;
+
+        fShelf.b0 = (Vh + Vb * K / Q + K * K) / a0;
+        fShelf.b1 = 2.0 * (K * K - Vh) / a0;
+        fShelf.b2 = (Vh - Vb * K / Q + K * K) / a0;
+        fShelf.a1 = 2.0 * (K * K - 1.0) / a0;
+        fShelf.a2 = (1.0 - K / Q + K * K) / a0;
+    }
+
+    // K-weighting, stage 2: RLB high-pass at ~38 Hz
+    {
+        const double f0 = 38.13547087602444;
+        const double Q  = 0.5003270373238773;
+
+        const double K  = std::tan(M_PI * f0 / sampleRate);
+        const double a0 = 1.0 + K / Q + K * K;
+
+        fHighPass.b0 = 1.0;
+        fHighPass.b1 = -2.0;
+        fHighPass.b2 = 1.0;
+        fHighPass.a1 = 2.0 * (K * K - 1.0) / a0;
+        fHighPass.a2 = (1.0 - K / Q + K * K) / a0;
+    }
+
+    if (fFilterState != nullptr)
+        delete[] fFilterState;
+    if (fWeights != nullptr)
+        delete[] fWeights;
+
+    fFilterState = (channels > 0) ? new double[channels*4] : nullptr;
+    fWeights     = (channels > 0) ? new float[channels] : nullptr;
+
+    for (uint32_t i=0; i < channels; ++i)
+        fWeights[i] = 1.0f;
+
+    if (fHistogram == nullptr)
+        fHistogram = new uint64_t[kHistogramBins];
+
+    if (fHistogramEnergies == nullptr)
+    {
+        fHistogramEnergies = new double[kHistogramBins];
+
+        // energy of each bin's center, used to average the gated blocks
+        for (uint32_t i=0; i < kHistogramBins; ++i)
+        {
+            const double loudness = kHistogramMin + (double(i) + 0.5) * kHistogramStep;
+            fHistogramEnergies[i] = std::pow(10.0, (loudness + 0.691) / 10.0);
+        }
+    }
+
+    clear();
+}
+
+void LoudnessMeter::setChannelWeight(const uint32_t channel, const float weight)
+{
+    if (channel < fChannels)
+        fWeights[channel] = weight;
+}
+
+void LoudnessMeter::process(const float* const* const buffers, const uint32_t frames)
+{
+    if (fChannels == 0)
+        return;
+
+    if (fResetRequested.exchange(false, std::memory_order_acquire))
+        clear();
+
+    uint32_t offset = 0;
+
+    while (offset < frames)
+    {
+        uint32_t count = fSubBlockFrames - fSubBlockPos;
+
+        if (count > frames - offset)
+            count = frames - offset;
+
+        for (uint32_t c=0; c < fChannels; ++c)
+        {
+            const float* const buffer = buffers[c] + offset;
+            double* const state = fFilterState + c*4;
+
+            double s1 = state[0], s2 = state[1], s3 = state[2], s4 = state[3];
+            double sum = 0.0;
+
+            for (uint32_t i=0; i < count; ++i)
+            {
+                // transposed direct form II, shelf then high-pass
+                const double x = buffer[i];
+
+                const double y1 = fShelf.b0 * x + s1;
+                s1 = fShelf.b1 * x - fShelf.a1 * y1 + s2;
+                s2 = fShelf.b2 * x - fShelf.a2 * y1;
+
+                const double y2 = fHighPass.b0 * y1 + s3;
+                s3 = fHighPass.b1 * y1 - fHighPass.a1 * y2 + s4;
+                s4 = fHighPass.b2 * y1 - fHighPass.a2 * y2;
+
+                sum += y2 * y2;
+            }
+
+            state[0] = s1;
+            state[1] = s2;
+            state[2] = s3;
+            state[3] = s4;
+
+            fSubBlockSum += sum * fWeights[c];
+        }
+
+        offset += count;
+        fSubBlockPos += count;
+
+        if (fSubBlockPos == fSubBlockFrames)
+            finishSubBlock();
+    }
+}
+
+void LoudnessMeter::requestReset()
+{
+    fResetRequested.store(true, std::memory_order_release);
+}
+
+float LoudnessMeter::getMomentary() const
+{
+    return fMomentary.load(std::memory_order_relaxed);
+}
+
+float LoudnessMeter::getShortTerm() const
+{
+    return fShortTerm.load(std::memory_order_relaxed);
+}
+
+float LoudnessMeter::getIntegrated() const
+{
+    return fIntegrated.load(std::memory_order_relaxed);
+}
+
+// -------------------------------
+
+void LoudnessMeter::clear()
+{
+    std::memset(fFilterState, 0, sizeof(double)*fChannels*4);
+    std::memset(fSubBlocks, 0, sizeof(fSubBlocks));
+    std::memset(fHistogram, 0, sizeof(uint64_t)*kHistogramBins);
+
+    fSubBlockPos   = 0;
+    fSubBlockSum   = 0.0;
+    fSubBlockIndex = 0;
+    fSubBlockCount = 0;
+
+    fMomentary.store(kSilence, std::memory_order_relaxed);
+    fShortTerm.store(kSilence, std::memory_order_relaxed);
+    fIntegrated.store(kSilence, std::memory_order_relaxed);
+}
+
+void LoudnessMeter::finishSubBlock()
+{
+    fSubBlocks[fSubBlockIndex] = fSubBlockSum / double(fSubBlockFrames);
+    fSubBlockIndex = (fSubBlockIndex + 1) % kShortTermBlocks;
+
+    if (fSubBlockCount < kShortTermBlocks)
+        ++fSubBlockCount;
+
+    fSubBlockPos = 0;
+    fSubBlockSum = 0.0;
+
+    // flush filter state that decayed into denormal range
+    for (uint32_t i=0; i < fChannels*4; ++i)
+    {
+        if (std::fabs(fFilterState[i]) < 1e-30)
+            fFilterState[i] = 0.0;
+    }
+
+    if (fSubBlockCount >= kMomentaryBlocks)
+    {
+        double energy = 0.0;
+
+        for (uint32_t i=1; i <= kMomentaryBlocks; ++i)
+            energy += fSubBlocks[(fSubBlockIndex + kShortTermBlocks - i) % kShortTermBlocks];
+
+        energy /= double(kMomentaryBlocks);
+
+        fMomentary.store(energy_to_published_loudness(energy), std::memory_order_relaxed);
+
+        // each momentary window is a gating block, absolute gate at -70 LUFS
+        if (energy > 0.0)
+        {
+            const double loudness = energy_to_loudness(energy);
+
+            if (loudness >= kHistogramMin)
+            {
+                uint32_t bin = uint32_t((loudness - kHistogramMin) / kHistogramStep);
+
+                if (bin >= kHistogramBins)
+                    bin = kHistogramBins - 1;
+
+                ++fHistogram[bin];
+                updateIntegrated();
+            }
+        }
+    }
+
+    if (fSubBlockCount >= kShortTermBlocks)
+    {
+        double energy = 0.0;
+
+        for (uint32_t i=0; i < kShortTermBlocks; ++i)
+            energy += fSubBlocks[i];
+
+        fShortTerm.store(energy_to_published_loudness(energy / double(kShortTermBlocks)), std::memory_order_relaxed);
+    }
+}
+
+void LoudnessMeter::updateIntegrated()
+{
+    uint64_t count  = 0;
+    double   energy = 0.0;
+
+    for (uint32_t i=0; i < kHistogramBins; ++i)
+    {
+        count  += fHistogram[i];
+        energy += fHistogram[i] * fHistogramEnergies[i];
+    }
+
+    if (count == 0)
+        return;
+
+    // relative gate, 10 LU below the absolute-gated average
+    const double gate = energy_to_loudness(energy / double(count)) - 10.0;
+
+    uint32_t start = 0;
+
+    if (gate > kHistogramMin)
+    {
+        start = uint32_t((gate - kHistogramMin) / kHistogramStep);
+
+        if (start >= kHistogramBins)
+            start = kHistogramBins - 1;
+    }
+
+    count  = 0;
+    energy = 0.0;
+
+    for (uint32_t i=start; i < kHistogramBins; ++i)
+    {
+        count  += fHistogram[i];
+        energy += fHistogram[i] * fHistogramEnergies[i];
+    }
+
+    if (count != 0)
+        fIntegrated.store(energy_to_published_loudness(energy / double(count)), std::memory_order_relaxed);
+}
@@ -0,0 +1,96 @@
+/*
+ * EBU R128 / ITU-R BS.1770 loudness meter
+ * Copyright (C) 2011-2026 Filipe Coelho <falktx@falktx.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * For a full copy of the GNU General Public License see the COPYING file
+ */
+
+#ifndef __LOUDNESS_HPP__
+#define __LOUDNESS_HPP__
+
+#include <atomic>
+#include <stdint.h>
+
+// Momentary (400 ms), short-term (3 s) and gated integrated loudness, in LUFS.
+//
+// Audio goes through the K-weighting filter cascade and is summed into 100 ms sub-blocks.
+// Momentary and short-term loudness are sliding windows over the last 4 and 30 sub-blocks.
+// Every 400 ms window (75% overlap) is also a gating block, counted into a fixed histogram
+// of 0.1 LU bins, so integrated loudness needs constant memory no matter how long it runs.
+//
+// setup() allocates and must be called before processing; process() is RT-safe.
+// The getters can be called from any thread.
+class LoudnessMeter
+{
+public:
+    // reported for silence, and before enough audio was measured
+    static const float kSilence;
+
+    LoudnessMeter();
+    ~LoudnessMeter();
+
+    void setup(uint32_t channels, double sampleRate);
+
+    // default is 1.0 for all channels; use 1.41 for surrounds and 0.0 for LFE
+    void setChannelWeight(uint32_t channel, float weight);
+
+    // RT thread, one buffer per channel
+    void process(const float* const* buffers, uint32_t frames);
+
+    // any thread, integrated loudness restarts on the next process() call
+    void requestReset();
+
+    float getMomentary() const;
+    float getShortTerm() const;
+    float getIntegrated() const;
+
+private:
+    struct Biquad {
+        double b0, b1, b2, a1, a2;
+    };
+
+    uint32_t fChannels;
+    uint32_t fSubBlockFrames;
+    uint32_t fSubBlockPos;
+
+    Biquad fShelf;
+    Biquad fHighPass;
+
+    // per channel: 2 state values for each of the 2 filters
+    double* fFilterState;
+    float*  fWeights;
+    double  fSubBlockSum;
+
+    // last 3 s of 100 ms sub-block energies
+    double   fSubBlocks[30];
+    uint32_t fSubBlockIndex;
+    uint32_t fSubBlockCount;
+
+    // gating block histogram
+    uint64_t* fHistogram;
+    double*   fHistogramEnergies;
+
+    std::atomic<float> fMomentary;
+    std::atomic<float> fShortTerm;
+    std::atomic<float> fIntegrated;
+    std::atomic<bool>  fResetRequested;
+
+    void clear();
+    void finishSubBlock();
+    void updateIntegrated();
+
+    LoudnessMeter(const LoudnessMeter&);
+    LoudnessMeter& operator=(const LoudnessMeter&);
+};
+
+#endif // __LOUDNESS_HPP__
@@ -0,0 +1,214 @@
+/*
+ * Peak detection kernels, used by the JACK meters
+ * Copyright (C) 2011-2026 Filipe Coelho <falktx@falktx.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * For a full copy of the GNU General Public License see the COPYING file
+ */
+
+#include "peakdetect.hpp"
+
+#include <cmath>
+
+#if defined(__GNUC__) && (defined(__i386__) || defined(__x86_64__))
+# define PEAKDETECT_X86
+# include <immintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+# define PEAKDETECT_NEON
+# include <arm_neon.h>
+#endif
+
+// -------------------------------
+// Scalar, always available
+
+float peak_detect_scalar(const float* const buffer, const uint32_t frames)
+{
+    float peak = 0.0f;
+
+    for (uint32_t i=0; i < frames; ++i)
+    {
+        const float value = std::fabs(buffer[i]);
+
+        if (value > peak)
+            peak = value;
+    }
+
+    return peak;
+}
+
+#ifdef PEAKDETECT_X86
+// -------------------------------
+// SSE2, 16 samples per iteration
+
+__attribute__((target("sse2")))
+static float peak_detect_sse2(const float* const buffer, const uint32_t frames)
+{
+    const __m128 absMask = _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff));
+
+    __m128 max1 = _mm_setzero_ps();
+    __m128 max2 = _mm_setzero_ps();
+    __m128 max3 = _mm_setzero_ps();
+    __m128 max4 = _mm_setzero_ps();
+
+    uint32_t i = 0;
+
+    for (; i+16 <= frames; i += 16)
+    {
+        max1 = _mm_max_ps(max1, _mm_and_ps(absMask, _mm_loadu_ps(buffer+i)));
+        max2 = _mm_max_ps(max2, _mm_and_ps(absMask, _mm_loadu_ps(buffer+i+4)));
+        max3 = _mm_max_ps(max3, _mm_and_ps(absMask, _mm_loadu_ps(buffer+i+8)));
+        max4 = _mm_max_ps(max4, _mm_and_ps(absMask, _mm_loadu_ps(buffer+i+12)));
+    }
+
+    for (; i+4 <= frames; i += 4)
+        max1 = _mm_max_ps(max1, _mm_and_ps(absMask, _mm_loadu_ps(buffer+i)));
+
+    max1 = _mm_max_ps(_mm_max_ps(max1, max2), _mm_max_ps(max3, max4));
+    max1 = _mm_max_ps(max1, _mm_shuffle_ps(max1, max1, _MM_SHUFFLE(1, 0, 3, 2)));
+    max1 = _mm_max_ps(max1, _mm_shuffle_ps(max1, max1, _MM_SHUFFLE(2, 3, 0, 1)));
+
+    float peak = _mm_cvtss_f32(max1);
+
+    for (; i < frames; ++i)
+    {
+        const float value = std::fabs(buffer[i]);
+
+        if (value > peak)
+            peak = value;
+    }
+
+    return peak;
+}
+
+// -------------------------------
+// AVX, 32 samples per iteration
+
+__attribute__((target("avx")))
+static float peak_detect_avx(const float* const buffer, const uint32_t frames)
+{
+    const __m256 absMask = _mm256_castsi256_ps(_mm256_set1_epi32(0x7fffffff));
+
+    __m256 max1 = _mm256_setzero_ps();
+    __m256 max2 = _mm256_setzero_ps();
+    __m256 max3 = _mm256_setzero_ps();
+    __m256 max4 = _mm256_setzero_ps();
+
+    uint32_t i = 0;
+
+    for (; i+32 <= frames; i += 32)
+    {
+        max1 = _mm256_max_ps(max1, _mm256_and_ps(absMask, _mm256_loadu_ps(buffer+i)));
+        max2 = _mm256_max_ps(max2, _mm256_and_ps(absMask, _mm256_loadu_ps(buffer+i+8)));
+        max3 = _mm256_max_ps(max3, _mm256_and_ps(absMask, _mm256_loadu_ps(buffer+i+16)));
+        max4 = _mm256_max_ps(max4, _mm256_and_ps(absMask, _mm256_loadu_ps(buffer+i+24)));
+    }
+
+    for (; i+8 <= frames; i += 8)
+        max1 = _mm256_max_ps(max1, _mm256_and_ps(absMask, _mm256_loadu_ps(buffer+i)));
+
+    max1 = _mm256_max_ps(_mm256_max_ps(max1, max2), _mm256_max_ps(max3, max4));
+
+    __m128 max = _mm_max_ps(_mm256_castps256_ps128(max1), _mm256_extractf128_ps(max1, 1));
+    max = _mm_max_ps(max, _mm_shuffle_ps(max, max, _MM_SHUFFLE(1, 0, 3, 2)));
+    max = _mm_max_ps(max, _mm_shuffle_ps(max, max, _MM_SHUFFLE(2, 3, 0, 1)));
+
+    float peak = _mm_cvtss_f32(max);
+
+    // avoid AVX-SSE transition penalties in the caller
+    _mm256_zeroupper();
+
+    for (; i < frames; ++i)
+    {
+        const float value = std::fabs(buffer[i]);
+
+        if (value > peak)
+            peak = value;
+    }
+
+    return peak;
+}
+#endif // PEAKDETECT_X86
+
+#ifdef PEAKDETECT_NEON
+// -------------------------------
+// NEON, 16 samples per iteration
+
+static float peak_detect_neon(const float* const buffer, const uint32_t frames)
+{
+    float32x4_t max1 = vdupq_n_f32(0.0f);
+    float32x4_t max2 = vdupq_n_f32(0.0f);
+    float32x4_t max3 = vdupq_n_f32(0.0f);
+    float32x4_t max4 = vdupq_n_f32(0.0f);
+
+    uint32_t i = 0;
+
+    for (; i+16 <= frames; i += 16)
+    {
+        max1 = vmaxq_f32(max1, vabsq_f32(vld1q_f32(buffer+i)));
+        max2 = vmaxq_f32(max2, vabsq_f32(vld1q_f32(buffer+i+4)));
+        max3 = vmaxq_f32(max3, vabsq_f32(vld1q_f32(buffer+i+8)));
+        max4 = vmaxq_f32(max4, vabsq_f32(vld1q_f32(buffer+i+12)));
+    }
+
+    for (; i+4 <= frames; i += 4)
+        max1 = vmaxq_f32(max1, vabsq_f32(vld1q_f32(buffer+i)));
+
+    max1 = vmaxq_f32(vmaxq_f32(max1, max2), vmaxq_f32(max3, max4));
+
+    float32x2_t max = vmax_f32(vget_low_f32(max1), vget_high_f32(max1));
+    max = vpmax_f32(max, max);
+
+    float peak = vget_lane_f32(max, 0);
+
+    for (; i < frames; ++i)
+    {
+        const float value = std::fabs(buffer[i]);
+
+        if (value > peak)
+            peak = value;
+    }
+
+    return peak;
+}
+#endif // PEAKDETECT_NEON
+
+// -------------------------------
+
+PeakDetectFunc peak_detect = peak_detect_scalar;
+
+static const char* sPeakDetectName = "scalar";
+
+void peak_detect_init()
+{
+#if defined(PEAKDETECT_X86)
+    __builtin_cpu_init();
+
+    if (__builtin_cpu_supports("avx"))
+    {
+        peak_detect = peak_detect_avx;
+        sPeakDetectName = "avx";
+    }
+    else if (__builtin_cpu_supports("sse2"))
+    {
+        peak_detect = peak_detect_sse2;
+        sPeakDetectName = "sse2";
+    }
+#elif defined(PEAKDETECT_NEON)
+    peak_detect = peak_detect_neon;
+    sPeakDetectName = "neon";
+#endif
+}
+
+const char* peak_detect_get_name()
+{
+    return sPeakDetectName;
+}
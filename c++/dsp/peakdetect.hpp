@@ -0,0 +1,37 @@
+/*
+ * Peak detection kernels, used by the JACK meters
+ * Copyright (C) 2011-2026 Filipe Coelho <falktx@falktx.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * For a full copy of the GNU General Public License see the COPYING file
+ */
+
+#ifndef __PEAKDETECT_HPP__
+#define __PEAKDETECT_HPP__
+
+#include <stdint.h>
+
+typedef float (*PeakDetectFunc)(const float* buffer, uint32_t frames);
+
+// Returns the absolute maximum of 'frames' samples.
+// Points to the scalar version until peak_detect_init() is called.
+extern PeakDetectFunc peak_detect;
+
+// Selects the best kernel for the running CPU, call once at startup.
+void peak_detect_init();
+
+// Name of the currently selected kernel, for debug and benchmarks.
+const char* peak_detect_get_name();
+
+float peak_detect_scalar(const float* buffer, uint32_t frames);
+
+#endif // __PEAKDETECT_HPP__
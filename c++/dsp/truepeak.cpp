@@ -0,0 +1,214 @@
+/*
+ * True-peak (inter-sample) detection, as in ITU-R BS.1770
+ * Copyright (C) 2011-2026 Filipe Coelho <falktx@falktx.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * For a full copy of the GNU General Public License see the COPYING file
+ */
+
+#include "truepeak.hpp"
+
+#include <cmath>
+#include <cstring>
+
+#if defined(__GNUC__) && (defined(__i386__) || defined(__x86_64__))
+# define TRUEPEAK_X86
+# include <immintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+# define TRUEPEAK_NEON
+# include <arm_neon.h>
+#endif
+
+static const uint32_t kPhases = TruePeakDetector::kPhases;
+static const uint32_t kTaps   = TruePeakDetector::kTaps;
+
+// input samples handled per kernel call, bounds the stack scratch buffer
+static const uint32_t kChunkSize = 256;
+
+// Polyphase interpolation filter from ITU-R BS.1770-4, Annex 2.
+// Stored per tap and then per phase, so one tap feeds all 4 output phases in a single vector op.
+static const float kCoeffs[kTaps][kPhases] = {
+    {  0.0017089843750f, -0.0291748046875f, -0.0189208984375f, -0.0083007812500f },
+    {  0.0109863281250f,  0.0292968750000f,  0.0330810546875f,  0.0148925781250f },
+    { -0.0196533203125f, -0.0517578125000f, -0.0582275390625f, -0.0266113281250f },
+    {  0.0332031250000f,  0.0891113281250f,  0.1015625000000f,  0.0476074218750f },
+    { -0.0594482421875f, -0.1665039062500f, -0.2003173828125f, -0.1022949218750f },
+    {  0.1373291015625f,  0.4650878906250f,  0.7797851562500f,  0.9721679687500f },
+    {  0.9721679687500f,  0.7797851562500f,  0.4650878906250f,  0.1373291015625f },
+    { -0.1022949218750f, -0.2003173828125f, -0.1665039062500f, -0.0594482421875f },
+    {  0.0476074218750f,  0.1015625000000f,  0.0891113281250f,  0.0332031250000f },
+    { -0.0266113281250f, -0.0582275390625f, -0.0517578125000f, -0.0196533203125f },
+    {  0.0148925781250f,  0.0330810546875f,  0.0292968750000f,  0.0109863281250f },
+    { -0.0083007812500f, -0.0189208984375f, -0.0291748046875f,  0.0017089843750f }
+};
+
+// Kernels take 'kTaps-1 + frames' contiguous samples, the first kTaps-1 being history.
+typedef float (*TruePeakKernel)(const float* samples, uint32_t frames);
+
+// -------------------------------
+// Scalar, always available
+
+static float true_peak_scalar(const float* const samples, const uint32_t frames)
+{
+    float peak = 0.0f;
+
+    for (uint32_t i=0; i < frames; ++i)
+    {
+        const float* const window = samples + i + kTaps - 1;
+
+        for (uint32_t p=0; p < kPhases; ++p)
+        {
+            float acc = 0.0f;
+
+            for (uint32_t k=0; k < kTaps; ++k)
+                acc += kCoeffs[k][p] * window[-int(k)];
+
+            acc = std::fabs(acc);
+
+            if (acc > peak)
+                peak = acc;
+        }
+    }
+
+    return peak;
+}
+
+#ifdef TRUEPEAK_X86
+// -------------------------------
+// SSE2, all 4 phases of one input sample per iteration
+
+__attribute__((target("sse2")))
+static float true_peak_sse2(const float* const samples, const uint32_t frames)
+{
+    const __m128 absMask = _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff));
+
+    __m128 coeffs[kTaps];
+
+    for (uint32_t k=0; k < kTaps; ++k)
+        coeffs[k] = _mm_loadu_ps(kCoeffs[k]);
+
+    __m128 max = _mm_setzero_ps();
+
+    for (uint32_t i=0; i < frames; ++i)
+    {
+        const float* const window = samples + i + kTaps - 1;
+
+        __m128 acc = _mm_mul_ps(coeffs[0], _mm_set1_ps(window[0]));
+
+        for (uint32_t k=1; k < kTaps; ++k)
+            acc = _mm_add_ps(acc, _mm_mul_ps(coeffs[k], _mm_set1_ps(window[-int(k)])));
+
+        max = _mm_max_ps(max, _mm_and_ps(absMask, acc));
+    }
+
+    max = _mm_max_ps(max, _mm_shuffle_ps(max, max, _MM_SHUFFLE(1, 0, 3, 2)));
+    max = _mm_max_ps(max, _mm_shuffle_ps(max, max, _MM_SHUFFLE(2, 3, 0, 1)));
+
+    return _mm_cvtss_f32(max);
+}
+#endif // TRUEPEAK_X86
+
+#ifdef TRUEPEAK_NEON
+// -------------------------------
+// NEON, all 4 phases of one input sample per iteration
+
+static float true_peak_neon(const float* const samples, const uint32_t frames)
+{
+    float32x4_t coeffs[kTaps];
+
+    for (uint32_t k=0; k < kTaps; ++k)
+        coeffs[k] = vld1q_f32(kCoeffs[k]);
+
+    float32x4_t max = vdupq_n_f32(0.0f);
+
+    for (uint32_t i=0; i < frames; ++i)
+    {
+        const float* const window = samples + i + kTaps - 1;
+
+        float32x4_t acc = vmulq_n_f32(coeffs[0], window[0]);
+
+        for (uint32_t k=1; k < kTaps; ++k)
+            acc = vmlaq_n_f32(acc, coeffs[k], window[-int(k)]);
+
+        max = vmaxq_f32(max, vabsq_f32(acc));
+    }
+
+    float32x2_t max2 = vmax_f32(vget_low_f32(max), vget_high_f32(max));
+    max2 = vpmax_f32(max2, max2);
+
+    return vget_lane_f32(max2, 0);
+}
+#endif // TRUEPEAK_NEON
+
+// -------------------------------
+
+static TruePeakKernel sTruePeakKernel = true_peak_scalar;
+static const char*    sTruePeakName   = "scalar";
+
+void true_peak_init()
+{
+#if defined(TRUEPEAK_X86)
+    __builtin_cpu_init();
+
+    if (__builtin_cpu_supports("sse2"))
+    {
+        sTruePeakKernel = true_peak_sse2;
+        sTruePeakName   = "sse2";
+    }
+#elif defined(TRUEPEAK_NEON)
+    sTruePeakKernel = true_peak_neon;
+    sTruePeakName   = "neon";
+#endif
+}
+
+const char* true_peak_get_name()
+{
+    return sTruePeakName;
+}
+
+// -------------------------------
+
+TruePeakDetector::TruePeakDetector()
+{
+    reset();
+}
+
+void TruePeakDetector::reset()
+{
+    std::memset(fHistory, 0, sizeof(fHistory));
+}
+
+float TruePeakDetector::process(const float* buffer, uint32_t frames)
+{
+    float samples[kTaps-1 + kChunkSize];
+    float peak = 0.0f;
+
+    while (frames > 0)
+    {
+        const uint32_t chunk = (frames < kChunkSize) ? frames : kChunkSize;
+
+        std::memcpy(samples, fHistory, sizeof(fHistory));
+        std::memcpy(samples + kTaps - 1, buffer, sizeof(float)*chunk);
+
+        const float chunkPeak = sTruePeakKernel(samples, chunk);
+
+        if (chunkPeak > peak)
+            peak = chunkPeak;
+
+        std::memcpy(fHistory, samples + chunk, sizeof(fHistory));
+
+        buffer += chunk;
+        frames -= chunk;
+    }
+
+    return peak;
+}
@@ -0,0 +1,50 @@
+/*
+ * True-peak (inter-sample) detection, as in ITU-R BS.1770
+ * Copyright (C) 2011-2026 Filipe Coelho <falktx@falktx.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * For a full copy of the GNU General Public License see the COPYING file
+ */
+
+#ifndef __TRUEPEAK_HPP__
+#define __TRUEPEAK_HPP__
+
+#include <stdint.h>
+
+// 4x oversampling through a 48-tap polyphase FIR (4 phases of 12 taps), followed by abs-max.
+// The cost is a fixed 48 multiply-adds per input sample, independent of the signal.
+class TruePeakDetector
+{
+public:
+    static const uint32_t kPhases = 4;
+    static const uint32_t kTaps   = 12;
+
+    TruePeakDetector();
+
+    // clears the filter history, not needed between periods
+    void reset();
+
+    // returns the highest oversampled absolute value of this block, RT-safe
+    float process(const float* buffer, uint32_t frames);
+
+private:
+    // last kTaps-1 input samples, oldest first
+    float fHistory[kTaps-1];
+};
+
+// Selects the best kernel for the running CPU, call once at startup.
+void true_peak_init();
+
+// Name of the currently selected kernel, for debug and benchmarks.
+const char* true_peak_get_name();
+
+#endif // __TRUEPEAK_HPP__
@@ -0,0 +1,176 @@
+/*
+ * Simple JACK Audio Meter, micro-benchmark for the DSP kernels
+ * Copyright (C) 2011-2026 Filipe Coelho <falktx@falktx.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * For a full copy of the GNU General Public License see the COPYING file
+ */
+
+#include "../dsp/ballistics.hpp"
+#include "../dsp/peakdetect.hpp"
+#include "../dsp/truepeak.hpp"
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+
+// -------------------------------
+
+static const uint32_t kMaxFrames = 4096;
+
+// target of the old per-sample loop, kept volatile like it used to be
+volatile double x_portValue = 0.0;
+
+// sink for benchmark results, so the compiler can't drop the work
+volatile float x_sink = 0.0f;
+
+static float buffer[kMaxFrames];
+
+// -------------------------------
+// The process_callback loop from before the SIMD kernels
+
+static void old_loop(const float* const buf, const uint32_t frames)
+{
+    for (uint32_t i = 0; i < frames; i++)
+    {
+        if (std::abs(buf[i]) > x_portValue)
+            x_portValue = std::abs(buf[i]);
+    }
+}
+
+// -------------------------------
+
+static uint32_t get_iterations(const uint32_t frames)
+{
+    // roughly the same amount of samples for every buffer size
+    return 64*1024*1024 / frames;
+}
+
+static double bench_old_loop(const uint32_t frames)
+{
+    const uint32_t iterations = get_iterations(frames);
+    const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+    for (uint32_t i=0; i < iterations; ++i)
+    {
+        x_portValue = 0.0;
+        old_loop(buffer, frames);
+    }
+
+    const std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+    return elapsed.count() / iterations;
+}
+
+static double bench_kernel(const PeakDetectFunc func, const uint32_t frames)
+{
+    const uint32_t iterations = get_iterations(frames);
+    const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+    for (uint32_t i=0; i < iterations; ++i)
+        x_sink = func(buffer, frames);
+
+    const std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+    return elapsed.count() / iterations;
+}
+
+static double bench_true_peak(const uint32_t frames)
+{
+    TruePeakDetector detector;
+
+    const uint32_t iterations = get_iterations(frames) / 16;
+    const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+    for (uint32_t i=0; i < iterations; ++i)
+        x_sink = detector.process(buffer, frames);
+
+    const std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+    return elapsed.count() / iterations;
+}
+
+static double bench_ballistics(const LevelBallistics::Mode mode, const uint32_t channels, const uint32_t frames)
+{
+    LevelBallistics ballistics;
+    ballistics.setup(channels, 48000.0, mode);
+
+    const uint32_t iterations = get_iterations(frames*channels);
+    const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+    for (uint32_t i=0; i < iterations; ++i)
+    {
+        for (uint32_t c=0; c < channels; ++c)
+            ballistics.process(c, buffer, frames);
+    }
+
+    x_sink = ballistics.getValue(0);
+
+    const std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+    return elapsed.count() / iterations;
+}
+
+// -------------------------------
+
+int main()
+{
+    std::srand(1);
+
+    for (uint32_t i=0; i < kMaxFrames; ++i)
+        buffer[i] = float(std::rand()) / RAND_MAX * 2.0f - 1.0f;
+
+    peak_detect_init();
+    true_peak_init();
+
+    std::printf("peak detection, selected kernel: %s\n", peak_detect_get_name());
+    std::printf("%8s %14s %14s %14s %9s\n", "frames", "old (ns)", "scalar (ns)", "simd (ns)", "speedup");
+
+    for (uint32_t frames = 16; frames <= kMaxFrames; frames *= 2)
+    {
+        const double oldTime    = bench_old_loop(frames);
+        const double scalarTime = bench_kernel(peak_detect_scalar, frames);
+        const double simdTime   = bench_kernel(peak_detect, frames);
+
+        if (std::fabs(float(x_portValue) - peak_detect(buffer, frames)) > 0.0f)
+            std::fprintf(stderr, "kernel mismatch at %u frames\n", frames);
+
+        std::printf("%8u %14.1f %14.1f %14.1f %8.1fx\n", frames, oldTime, scalarTime, simdTime, oldTime/simdTime);
+    }
+
+    // cost of one channel as a share of the period at 48 kHz, and how many channels fit in half of it
+    std::printf("\ntrue-peak, 4x oversampling, selected kernel: %s\n", true_peak_get_name());
+    std::printf("%8s %14s %14s %14s\n", "frames", "per ch (ns)", "period (%)", "ch @ 50%");
+
+    for (uint32_t frames = 32; frames <= kMaxFrames/2; frames *= 2)
+    {
+        const double time   = bench_true_peak(frames);
+        const double period = double(frames) / 48000.0 * 1e9;
+
+        std::printf("%8u %14.1f %14.3f %14u\n", frames, time, time/period*100.0, uint32_t(period*0.5/time));
+    }
+
+    // whole period of a 64 channel meter at 32 frames
+    {
+        static const char* const names[] = { "rms", "vu", "ppm type I", "ppm type II" };
+        const double period = 32.0 / 48000.0 * 1e9;
+
+        std::printf("\nballistics, 64 channels at 32 frames\n");
+        std::printf("%12s %14s %14s\n", "mode", "period (ns)", "period (%)");
+
+        for (int mode = LevelBallistics::MODE_RMS; mode <= LevelBallistics::MODE_PPM_TYPE_II; ++mode)
+        {
+            const double time = bench_ballistics(static_cast<LevelBallistics::Mode>(mode), 64, 32);
+
+            std::printf("%12s %14.1f %14.3f\n", names[mode], time, time/period*100.0);
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,247 @@
+/*
+ * Simple JACK Audio Meter, painting benchmark for the meter widget
+ * Copyright (C) 2011-2026 Filipe Coelho <falktx@falktx.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * For a full copy of the GNU General Public License see the COPYING file
+ */
+
+#include <QtCore/Qt>
+
+#ifndef Q_COMPILER_LAMBDA
+# define nullptr (0)
+#endif
+
+#include "../widgets/digitalpeakmeter.hpp"
+
+#include <QtCore/QElapsedTimer>
+#include <QtGui/QPainter>
+#include <QtGui/QPaintEvent>
+#include <QtWidgets/QApplication>
+
+#include <cstdio>
+#include <cstdlib>
+
+// -------------------------------
+
+static const int kChannels   = 64;
+static const int kIterations = 1000;
+
+// -------------------------------
+// The meter painting from before the cached layers, vertical only.
+// Every change repaints the whole widget and every channel is drawn with QPainter primitives.
+
+class OldPeakMeter : public QWidget
+{
+public:
+    OldPeakMeter(const int channels)
+        : QWidget(nullptr),
+          fChannels(channels),
+          fColorBackground("#111111"),
+          fGradientMeter(0, 0, 1, 1),
+          fColorBaseAlt(15, 110, 15, 100),
+          fChannelsData(new float[channels]),
+          fPeakHoldData(new float[channels]),
+          fPeakHoldCounters(new int[channels]),
+          fClipCounts(new uint[channels])
+    {
+        const QColor colorBase(93, 231, 61);
+
+        fGradientMeter.setColorAt(0.0f, Qt::red);
+        fGradientMeter.setColorAt(0.2f, Qt::yellow);
+        fGradientMeter.setColorAt(0.4f, colorBase);
+        fGradientMeter.setColorAt(1.0f, colorBase);
+
+        for (int i=0; i < channels; ++i)
+        {
+            fChannelsData[i]     = 0.0f;
+            fPeakHoldData[i]     = 0.0f;
+            fPeakHoldCounters[i] = 0;
+            fClipCounts[i]       = 0;
+        }
+    }
+
+    ~OldPeakMeter()
+    {
+        delete[] fChannelsData;
+        delete[] fPeakHoldData;
+        delete[] fPeakHoldCounters;
+        delete[] fClipCounts;
+    }
+
+    // same hold and decay as the bench sets on the new meter
+    void displayMeter(const int meter, float level)
+    {
+        const int i = meter - 1;
+
+        if (level >= 1.0f)
+            ++fClipCounts[i];
+
+        if (level < 0.001f)
+            level = 0.0f;
+        else if (level > 0.999f)
+            level = 1.0f;
+
+        if (fChannelsData[i] != level)
+        {
+            fChannelsData[i] = level;
+            update();
+        }
+
+        float peakHold = fPeakHoldData[i];
+
+        if (level >= peakHold)
+        {
+            peakHold = level;
+            fPeakHoldCounters[i] = 40;
+        }
+        else if (fPeakHoldCounters[i] > 0)
+        {
+            --fPeakHoldCounters[i];
+        }
+        else
+        {
+            peakHold -= 0.02f;
+
+            if (peakHold < level)
+                peakHold = level;
+        }
+
+        if (fPeakHoldData[i] != peakHold)
+        {
+            fPeakHoldData[i] = peakHold;
+            update();
+        }
+    }
+
+protected:
+    void paintEvent(QPaintEvent* event)
+    {
+        QPainter painter(this);
+        event->accept();
+
+        const int width     = this->width();
+        const int height    = this->height();
+        const int sizeMeter = width/fChannels;
+
+        fGradientMeter.setFinalStop(0, height);
+
+        painter.setPen(Qt::black);
+        painter.setBrush(Qt::black);
+        painter.drawRect(0, 0, width, height);
+
+        painter.setPen(fColorBackground);
+        painter.setBrush(fGradientMeter);
+
+        for (int i=0; i < fChannels; ++i)
+            painter.drawRect(i*sizeMeter, int(float(height) - fChannelsData[i]*float(height)), sizeMeter, height);
+
+        for (int i=0; i < fChannels; ++i)
+        {
+            const int meterX = i*sizeMeter;
+            const float peakHold = fPeakHoldData[i];
+
+            if (peakHold > 0.0f)
+            {
+                const int y = int(float(height-1) - peakHold * float(height-1));
+                painter.setPen(peakHold >= 0.999f ? Qt::red : Qt::white);
+                painter.drawLine(meterX+1, y, meterX+sizeMeter-1, y);
+            }
+
+            if (fClipCounts[i] > 0)
+                painter.fillRect(meterX, 0, sizeMeter, 3, Qt::red);
+        }
+
+        // base, yellow, orange and red scale marks
+        static const float marks[] = { 0.25f, 0.50f, 0.70f, 0.83f, 0.90f, 0.96f };
+        const QColor colors[] = { fColorBaseAlt, fColorBaseAlt, QColor(110, 110, 15, 100), QColor(110, 110, 15, 100),
+                                  QColor(180, 110, 15, 100), QColor(110, 15, 15, 100) };
+        const float lsmall = height;
+        const float lfull  = width - 1;
+
+        painter.setBrush(Qt::black);
+
+        for (int i=0; i < 6; ++i)
+        {
+            painter.setPen(colors[i]);
+            painter.drawLine(QLineF(2, lsmall - lsmall*marks[i], lfull-2.0f, lsmall - lsmall*marks[i]));
+        }
+    }
+
+private:
+    const int fChannels;
+
+    QColor fColorBackground;
+    QLinearGradient fGradientMeter;
+    QColor fColorBaseAlt;
+
+    float* fChannelsData;
+    float* fPeakHoldData;
+    int*   fPeakHoldCounters;
+    uint*  fClipCounts;
+};
+
+// -------------------------------
+
+// updates 'changing' channels per frame and lets Qt paint what got dirty, returns ms per frame
+template<class Meter>
+static double bench_paint(QApplication& app, Meter& meter, const int changing)
+{
+    QElapsedTimer timer;
+    timer.start();
+
+    for (int i=0; i < kIterations; ++i)
+    {
+        for (int j=0; j < changing; ++j)
+            meter.displayMeter((i*changing + j) % kChannels + 1, float(std::rand()) / float(RAND_MAX) * 0.9f);
+
+        app.processEvents();
+    }
+
+    return double(timer.nsecsElapsed()) / 1e6 / kIterations;
+}
+
+int main(int argc, char* argv[])
+{
+    // 'make paint-bench' runs it offscreen, so it needs no display and the numbers don't depend on the compositor
+    QApplication app(argc, argv);
+
+    OldPeakMeter oldMeter(kChannels);
+    oldMeter.resize(kChannels*16, 600);
+    oldMeter.show();
+
+    DigitalPeakMeter meter(nullptr);
+    meter.setChannels(kChannels);
+    meter.setOrientation(DigitalPeakMeter::VERTICAL);
+    meter.setSmoothRelease(0);
+    meter.setPeakHold(40, 0.02f);
+    meter.resize(kChannels*16, 600);
+    meter.show();
+
+    app.processEvents();
+
+    std::printf("painting %i channels, %i frames\n", kChannels, kIterations);
+    std::printf("%10s %14s %14s %9s\n", "changing", "old (ms)", "cached (ms)", "speedup");
+
+    for (int changing = 1; changing <= kChannels; changing *= 4)
+    {
+        std::srand(1);
+        const double oldTime = bench_paint(app, oldMeter, changing);
+
+        std::srand(1);
+        const double newTime = bench_paint(app, meter, changing);
+
+        std::printf("%10i %14.3f %14.3f %8.1fx\n", changing, oldTime, newTime, oldTime/newTime);
+    }
+
+    return 0;
+}
@@ -0,0 +1,114 @@
+/*
+ * Simple JACK Audio Meter, concurrent stress test for the peak handoff
+ * Copyright (C) 2011-2026 Filipe Coelho <falktx@falktx.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * For a full copy of the GNU General Public License see the COPYING file
+ */
+
+#include "../peak_store.hpp"
+
+#include <atomic>
+#include <cstdio>
+#include <thread>
+
+// -------------------------------
+
+static const uint32_t kChannels = 4;
+static const uint32_t kRounds   = 2*1000*1000;
+
+static PeakStore gPeaks;
+static std::atomic<bool> gDone(false);
+
+static uint32_t gFailures = 0;
+
+// -------------------------------
+// RT side: every channel gets a strictly rising sequence.
+// All values are exact in a float (< 2^24), so any value the GUI sees can be matched to a round.
+
+static void publisher()
+{
+    for (uint32_t r=1; r <= kRounds; ++r)
+    {
+        for (uint32_t c=0; c < kChannels; ++c)
+        {
+            // a lower value in between must never replace the pending maximum
+            gPeaks.publish(c, float(r));
+            gPeaks.publish(c, float(r) - 0.5f);
+        }
+    }
+
+    gDone.store(true, std::memory_order_release);
+}
+
+// -------------------------------
+// GUI side: what it takes must keep rising, and the last round must be seen.
+// The only lower value allowed is the second half of a round whose maximum was already taken.
+
+static void check(const uint32_t channel, const float value, float& last)
+{
+    if (value == 0.0f)
+        return;
+
+    if (value > last)
+    {
+        last = value;
+        return;
+    }
+
+    if (value == last - 0.5f)
+        return;
+
+    std::fprintf(stderr, "channel %u: took %.1f after %.1f\n", channel, value, last);
+    ++gFailures;
+}
+
+int main()
+{
+    gPeaks.setCount(kChannels);
+
+    float last[kChannels] = { 0.0f };
+    uint32_t takes = 0;
+
+    std::thread thread(publisher);
+
+    while (! gDone.load(std::memory_order_acquire))
+    {
+        for (uint32_t c=0; c < kChannels; ++c)
+            check(c, gPeaks.take(c), last[c]);
+
+        ++takes;
+    }
+
+    thread.join();
+
+    for (uint32_t c=0; c < kChannels; ++c)
+    {
+        check(c, gPeaks.take(c), last[c]);
+
+        if (last[c] != float(kRounds))
+        {
+            std::fprintf(stderr, "channel %u: final maximum lost, got %.1f, expected %u\n", c, last[c], kRounds);
+            ++gFailures;
+        }
+
+        if (gPeaks.take(c) != 0.0f)
+        {
+            std::fprintf(stderr, "channel %u: not reset by take()\n", c);
+            ++gFailures;
+        }
+    }
+
+    std::printf("peak handoff: %u channels, %u rounds, %u GUI ticks, %u failures\n", kChannels, kRounds, takes, gFailures);
+
+    return (gFailures == 0) ? 0 : 1;
+}
@@ -24,51 +24,259 @@
 #define VERSION "0.8.1"
 
 #include "../jack_utils.hpp"
+#include "../peak_store.hpp"
+#include "../ring_buffer.hpp"
+#include "../dsp/ballistics.hpp"
+#include "../dsp/loudness.hpp"
+#include "../dsp/peakdetect.hpp"
+#include "../dsp/truepeak.hpp"
 #include "../widgets/digitalpeakmeter.hpp"
 
 #include <cmath>
+#include <csignal>
+#include <cstdio>
+#include <QtCore/QMutex>
+#include <QtCore/QSet>
 #include <QtGui/QIcon>
+#include <QtGui/QPainter>
 #include <QtWidgets/QApplication>
 #include <QtWidgets/QMessageBox>
 
+#ifndef Q_OS_WIN
+# include <cerrno>
+# include <sys/socket.h>
+# include <sys/un.h>
+# include <unistd.h>
+#endif
+
 // -------------------------------
 
-volatile double x_portValue1 = 0.0;
-volatile double x_portValue2 = 0.0;
+static const int kMaxChannels = 256;
+
+// one peak per channel, filled by the RT thread and taken by the GUI
+PeakStore gPeaks;
+
 volatile bool x_isOutput = true;
+volatile bool x_isTruePeak = false;
+volatile bool x_isLoudness = false;
+volatile bool x_hasBallistics = false;
+volatile bool x_isHeadless = false;
+volatile bool x_isBinary = false;
 volatile bool x_needReconnect = false;
-volatile bool x_quitNow = false;
+volatile sig_atomic_t x_quitNow = 0; // also set from signal_handler()
 
 jack_client_t* jClient = nullptr;
-jack_port_t* jPort1 = nullptr;
-jack_port_t* jPort2 = nullptr;
+jack_port_t** jPorts = nullptr;
+TruePeakDetector* gTruePeaks = nullptr;
+
+LevelBallistics gBallistics;
+LevelBallistics::Mode gBallisticsMode = LevelBallistics::MODE_RMS;
+LoudnessMeter gLoudness;
+const float** gBuffers = nullptr;
 
+int gChannels = 2;
 QString gClientName;
 
+// -------------------------------
+// headless mode, levels of the current interval and the records waiting for the writer
+
+struct LevelRecordHeader {
+    uint64_t frame;   // frames processed since activation, at the end of the interval
+    uint32_t frames;  // length of the interval
+    uint32_t dropped; // records lost right before this one because the ring was full
+};
+// followed by peak and RMS per channel, as linear floats
+
+struct LevelStreamHeader {
+    char     magic[4]; // "JKM1"
+    uint32_t channels;
+    uint32_t sampleRate;
+    uint32_t interval;
+};
+
+RingBuffer gLevelRing;
+float*   gLevelPeaks  = nullptr;
+double*  gLevelSums   = nullptr;
+uint8_t* gLevelRecord = nullptr;
+
+uint32_t gLevelRecordSize = 0;
+uint32_t gLevelInterval   = 0;
+uint32_t gLevelFrames     = 0;
+uint32_t gLevelDropped    = 0;
+uint64_t gFrameCount      = 0;
+
+int     gLevelRate = 10;
+QString gSocketPath;
+
+// -------------------------------
+// output mode connection tracking, kept up to date by port_callback
+
+struct ChannelConnections {
+    QSet<QString> meterSources; // ports connected to our inN
+};
+
+struct PendingConnection {
+    QString source;
+    int channel;
+};
+
+QMutex gConnectionMutex;
+ChannelConnections* gConnections = nullptr;
+QList<PendingConnection> gPendingConnections;
+
 // -------------------------------
 // JACK callbacks
 
-int process_callback(const jack_nframes_t nframes, void*)
+static inline
+double sum_of_squares(const float* const buffer, const uint32_t frames)
+{
+    double sum = 0.0;
+
+    for (uint32_t i=0; i < frames; ++i)
+        sum += double(buffer[i])*buffer[i];
+
+    return sum;
+}
+
+// RT thread, sends a record once the interval is complete, never waits for the writer
+static void headless_period_done(const jack_nframes_t nframes)
 {
-    float* const jOut1 = (float*)jackbridge_port_get_buffer(jPort1, nframes);
-    float* const jOut2 = (float*)jackbridge_port_get_buffer(jPort2, nframes);
+    gFrameCount  += nframes;
+    gLevelFrames += nframes;
+
+    if (gLevelFrames < gLevelInterval)
+        return;
+
+    LevelRecordHeader* const header = (LevelRecordHeader*)gLevelRecord;
+    header->frame   = gFrameCount;
+    header->frames  = gLevelFrames;
+    header->dropped = gLevelDropped;
 
-    for (jack_nframes_t i = 0; i < nframes; i++)
+    float* const levels = (float*)(gLevelRecord + sizeof(LevelRecordHeader));
+
+    for (int i=0; i < gChannels; ++i)
     {
-        if (std::abs(jOut1[i]) > x_portValue1)
-            x_portValue1 = std::abs(jOut1[i]);
+        levels[i*2]   = gLevelPeaks[i];
+        levels[i*2+1] = std::sqrt(gLevelSums[i] / gLevelFrames);
 
-        if (std::abs(jOut2[i]) > x_portValue2)
-            x_portValue2 = std::abs(jOut2[i]);
+        gLevelPeaks[i] = 0.0f;
+        gLevelSums[i]  = 0.0;
     }
 
+    if (gLevelRing.write(gLevelRecord, gLevelRecordSize))
+        gLevelDropped = 0;
+    else
+        ++gLevelDropped;
+
+    gLevelFrames = 0;
+}
+
+int process_callback(const jack_nframes_t nframes, void*)
+{
+    for (int i=0; i < gChannels; ++i)
+    {
+        const float* const jOut = (float*)jackbridge_port_get_buffer(jPorts[i], nframes);
+
+        if (x_isHeadless)
+        {
+            const float peak = x_isTruePeak ? gTruePeaks[i].process(jOut, nframes) : peak_detect(jOut, nframes);
+
+            if (peak > gLevelPeaks[i])
+                gLevelPeaks[i] = peak;
+
+            gLevelSums[i] += sum_of_squares(jOut, nframes);
+        }
+        // reduce the whole period locally, only touch the shared value once
+        else if (x_hasBallistics)
+            gBallistics.process(i, jOut, nframes);
+        else if (x_isTruePeak)
+            gPeaks.publish(i, gTruePeaks[i].process(jOut, nframes));
+        else
+            gPeaks.publish(i, peak_detect(jOut, nframes));
+
+        gBuffers[i] = jOut;
+    }
+
+    if (x_isLoudness)
+        gLoudness.process(gBuffers, nframes);
+
+    if (x_isHeadless)
+        headless_period_done(nframes);
+
     return 0;
 }
 
-void port_callback(jack_port_id_t, jack_port_id_t, int, void*)
+// index of a system:playback_N port within our channels, -1 if not one
+static int get_playback_channel(const QString& name)
 {
-    if (x_isOutput)
-        x_needReconnect = true;
+    static const QString prefix("system:playback_");
+
+    if (! name.startsWith(prefix))
+        return -1;
+
+    bool ok = false;
+    const int channel = name.mid(prefix.size()).toInt(&ok) - 1;
+
+    return (ok && channel >= 0 && channel < gChannels) ? channel : -1;
+}
+
+static int get_meter_channel(const jack_port_t* const port)
+{
+    for (int i=0; i < gChannels; ++i)
+    {
+        if (jPorts[i] == port)
+            return i;
+    }
+
+    return -1;
+}
+
+// only looks at the ports of this one connection, connecting is left to the main thread
+void port_callback(jack_port_id_t a, jack_port_id_t b, int connect, void*)
+{
+    if (! x_isOutput)
+        return;
+
+    jack_port_t* const portA = jackbridge_port_by_id(jClient, a);
+    jack_port_t* const portB = jackbridge_port_by_id(jClient, b);
+
+    if (portA == nullptr || portB == nullptr)
+        return;
+
+    const QString source(jackbridge_port_name(portA));
+    const QString destination(jackbridge_port_name(portB));
+
+    const QMutexLocker locker(&gConnectionMutex);
+
+    const int meterChannel = get_meter_channel(portB);
+
+    if (meterChannel >= 0)
+    {
+        if (connect)
+            gConnections[meterChannel].meterSources.insert(source);
+        else
+            gConnections[meterChannel].meterSources.remove(source);
+        return;
+    }
+
+    const int playbackChannel = get_playback_channel(destination);
+
+    if (playbackChannel < 0)
+        return;
+
+    // a source leaving system:playback_N keeps its meter connection, like before
+    if (! connect)
+        return;
+
+    if (jackbridge_port_is_mine(jClient, portA) || gConnections[playbackChannel].meterSources.contains(source))
+        return;
+
+    PendingConnection pending;
+    pending.source  = source;
+    pending.channel = playbackChannel;
+    gPendingConnections.append(pending);
+
+    x_needReconnect = true;
 }
 
 #ifdef HAVE_JACKSESSION
@@ -95,53 +303,98 @@ void session_callback(jack_session_event_t* const event, void* const arg)
 // -------------------------------
 // helpers
 
-void reconnect_ports()
+// main thread, makes the connections port_callback found missing
+void connect_pending_ports()
 {
     x_needReconnect = false;
 
-    const QString nameIn1(gClientName+":in1");
-    const QString nameIn2(gClientName+":in2");
+    gConnectionMutex.lock();
+    QList<PendingConnection> pendingConnections;
+    pendingConnections.swap(gPendingConnections);
+    gConnectionMutex.unlock();
 
-    if (x_isOutput)
+    foreach (const PendingConnection& pending, pendingConnections)
     {
-        jack_port_t* const jPlayPort1 = jackbridge_port_by_name(jClient, x_isOutput ? "system:playback_1" : "system:capture_1");
-        jack_port_t* const jPlayPort2 = jackbridge_port_by_name(jClient, x_isOutput ? "system:playback_2" : "system:capture_2");
-        std::vector<char*> jPortList1(jackbridge_port_get_all_connections_as_vector(jClient, jPlayPort1));
-        std::vector<char*> jPortList2(jackbridge_port_get_all_connections_as_vector(jClient, jPlayPort2));
+        // might have been connected since it was queued
+        gConnectionMutex.lock();
+        const bool connected = gConnections[pending.channel].meterSources.contains(pending.source);
+        gConnectionMutex.unlock();
 
-        foreach (char* const& thisPortName, jPortList1)
-        {
-            jack_port_t* const thisPort = jackbridge_port_by_name(jClient, thisPortName);
+        if (connected)
+            continue;
 
-            if (! (jackbridge_port_is_mine(jClient, thisPort) || jackbridge_port_connected_to(jPort1, thisPortName)))
-                jackbridge_connect(jClient, thisPortName, nameIn1.toUtf8().constData());
+        const QString nameIn(gClientName + QString(":in%1").arg(pending.channel+1));
+        jackbridge_connect(jClient, pending.source.toUtf8().constData(), nameIn.toUtf8().constData());
+    }
+}
 
-            free(thisPortName);
-        }
+// full scan, only done once at startup
+void reconnect_ports()
+{
+    for (int i=0; i < gChannels; ++i)
+    {
+        const QString nameIn(gClientName + QString(":in%1").arg(i+1));
 
-        foreach (char* const& thisPortName, jPortList2)
+        if (x_isOutput)
         {
-            jack_port_t* const thisPort = jackbridge_port_by_name(jClient, thisPortName);
+            const QString namePlay(QString("system:playback_%1").arg(i+1));
+            jack_port_t* const jPlayPort = jackbridge_port_by_name(jClient, namePlay.toUtf8().constData());
+
+            if (jPlayPort == nullptr)
+                continue;
 
-            if (! (jackbridge_port_is_mine(jClient, thisPort) || jackbridge_port_connected_to(jPort2, thisPortName)))
-                jackbridge_connect(jClient, thisPortName, nameIn2.toUtf8().constData());
+            // query JACK first, the lock is only held to update the cache
+            QStringList meterSources, missingSources;
 
-            free(thisPortName);
+            if (const char** const connections = jackbridge_port_get_connections(jPorts[i]))
+            {
+                for (int j=0; connections[j] != nullptr; ++j)
+                    meterSources.append(connections[j]);
+
+                jackbridge_free(connections);
+            }
+
+            if (const char** const connections = jackbridge_port_get_all_connections(jClient, jPlayPort))
+            {
+                for (int j=0; connections[j] != nullptr; ++j)
+                {
+                    jack_port_t* const jSourcePort = jackbridge_port_by_name(jClient, connections[j]);
+
+                    if (jSourcePort != nullptr && ! jackbridge_port_is_mine(jClient, jSourcePort))
+                        missingSources.append(connections[j]);
+                }
+
+                jackbridge_free(connections);
+            }
+
+            const QMutexLocker locker(&gConnectionMutex);
+            ChannelConnections& connections(gConnections[i]);
+
+            foreach (const QString& source, meterSources)
+                connections.meterSources.insert(source);
+
+            foreach (const QString& source, missingSources)
+            {
+                if (connections.meterSources.contains(source))
+                    continue;
+
+                PendingConnection pending;
+                pending.source  = source;
+                pending.channel = i;
+                gPendingConnections.append(pending);
+            }
         }
+        else
+        {
+            const QString nameCapture(QString("system:capture_%1").arg(i+1));
 
-        jPortList1.clear();
-        jPortList2.clear();
+            if (jackbridge_port_by_name(jClient, nameCapture.toUtf8().constData()) != nullptr)
+                if (! jackbridge_port_connected_to(jPorts[i], nameCapture.toUtf8().constData()))
+                    jackbridge_connect(jClient, nameCapture.toUtf8().constData(), nameIn.toUtf8().constData());
+        }
     }
-    else
-    {
-        if (jackbridge_port_by_name(jClient, "system:capture_1") != nullptr)
-            if (! jackbridge_port_connected_to(jPort1, "system:capture_1"))
-                jackbridge_connect(jClient, "system:capture_1", nameIn1.toUtf8().constData());
 
-        if (jackbridge_port_by_name(jClient, "system:capture_2") != nullptr)
-            if (! jackbridge_port_connected_to(jPort2, "system:capture_2"))
-                jackbridge_connect(jClient, "system:capture_2", nameIn2.toUtf8().constData());
-    }
+    connect_pending_ports();
 }
 
 // -------------------------------
@@ -160,16 +413,26 @@ public:
         else
             setColor(Color::BLUE);
 
-        setChannels(2);
+        setChannels(gChannels);
         setOrientation(VERTICAL);
-        setSmoothRelease(1);
 
-        displayMeter(1, 0.0f);
-        displayMeter(2, 0.0f);
+        // ballistics are already applied in the RT thread, only draw them
+        setSmoothRelease(x_hasBallistics ? 0 : 1);
+
+        for (int i=1; i <= gChannels; ++i)
+            displayMeter(i, 0.0f);
+
+        m_momentary = m_shortTerm = m_integrated = LoudnessMeter::kSilence;
 
         int refresh = float(jackbridge_get_buffer_size(jClient)) / jackbridge_get_sample_rate(jClient) * 1000;
 
-        m_peakTimerId = startTimer(refresh > 50 ? refresh : 50);
+        if (refresh < 50)
+            refresh = 50;
+
+        // hold peaks for 2 seconds, then fall the whole scale in 1.5 seconds
+        setPeakHold(2000/refresh, float(refresh)/1500.0f);
+
+        m_peakTimerId = startTimer(refresh);
     }
 
 protected:
@@ -184,36 +447,369 @@ protected:
 
         if (event->timerId() == m_peakTimerId)
         {
-            displayMeter(1, x_portValue1);
-            displayMeter(2, x_portValue2);
-            x_portValue1 = 0.0;
-            x_portValue2 = 0.0;
+            if (x_hasBallistics)
+            {
+                for (int i=0; i < gChannels; ++i)
+                    displayMeter(i+1, gBallistics.getValue(i));
+            }
+            else
+            {
+                for (int i=0; i < gChannels; ++i)
+                    displayMeter(i+1, gPeaks.take(i));
+            }
+
+            if (x_isLoudness)
+            {
+                const float momentary  = gLoudness.getMomentary();
+                const float shortTerm  = gLoudness.getShortTerm();
+                const float integrated = gLoudness.getIntegrated();
+
+                if (momentary != m_momentary || shortTerm != m_shortTerm || integrated != m_integrated)
+                {
+                    m_momentary  = momentary;
+                    m_shortTerm  = shortTerm;
+                    m_integrated = integrated;
+                    update();
+                }
+            }
 
             if (x_needReconnect)
-                reconnect_ports();
+                connect_pending_ports();
         }
 
         QWidget::timerEvent(event);
     }
 
+    void paintEvent(QPaintEvent* event)
+    {
+        DigitalPeakMeter::paintEvent(event);
+
+        if (! x_isLoudness)
+            return;
+
+        QPainter painter(this);
+        painter.setPen(Qt::white);
+
+        const int lineHeight = painter.fontMetrics().height();
+        int y = height() - lineHeight*3 - 2;
+
+        painter.fillRect(0, y, width(), lineHeight*3 + 2, QColor(0, 0, 0, 160));
+
+        y += painter.fontMetrics().ascent() + 1;
+        painter.drawText(2, y, loudnessText("M", m_momentary));
+        y += lineHeight;
+        painter.drawText(2, y, loudnessText("S", m_shortTerm));
+        y += lineHeight;
+        painter.drawText(2, y, loudnessText("I", m_integrated));
+    }
+
+    void mouseDoubleClickEvent(QMouseEvent* event)
+    {
+        // restart integrated loudness and forget previous clips
+        if (x_isLoudness)
+            gLoudness.requestReset();
+
+        resetClipCounts();
+
+        DigitalPeakMeter::mouseDoubleClickEvent(event);
+    }
+
 private:
     int m_peakTimerId;
+
+    float m_momentary;
+    float m_shortTerm;
+    float m_integrated;
+
+    static QString loudnessText(const char* const label, const float value)
+    {
+        if (value <= -70.0f)
+            return QString("%1 --.-").arg(label);
+
+        return QString("%1 %2").arg(label).arg(double(value), 0, 'f', 1);
+    }
 };
 
 // -------------------------------
+// headless writer, runs in the main thread
 
-int main(int argc, char* argv[])
+#ifndef Q_OS_WIN
+static void signal_handler(int)
 {
-    QApplication app(argc, argv);
-    app.setApplicationName("JackMeter");
-    app.setApplicationVersion(VERSION);
-    app.setOrganizationName("Cadence");
-    app.setWindowIcon(QIcon(":/scalable/cadence.svg"));
+    x_quitNow = true;
+}
+
+static int open_socket(const QString& path)
+{
+    const QByteArray pathData(path.toLocal8Bit());
+
+    sockaddr_un address;
+    std::memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+
+    if (pathData.size() >= int(sizeof(address.sun_path)))
+        return -1;
+
+    std::strcpy(address.sun_path, pathData.constData());
+
+    const int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+
+    if (fd < 0)
+        return -1;
+
+    if (::connect(fd, (sockaddr*)&address, sizeof(address)) != 0)
+    {
+        ::close(fd);
+        return -1;
+    }
+
+    return fd;
+}
+
+static bool write_all(const int fd, const void* const data, const size_t size)
+{
+    const char* ptr = static_cast<const char*>(data);
+    size_t left = size;
+
+    while (left > 0)
+    {
+        const ssize_t ret = ::write(fd, ptr, left);
+
+        if (ret < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            return false;
+        }
+
+        ptr  += ret;
+        left -= size_t(ret);
+    }
 
-    if (app.arguments().contains("-in"))
+    return true;
+}
+
+static bool write_stream_header(const int fd)
+{
+    if (x_isBinary)
+    {
+        LevelStreamHeader header;
+        std::memcpy(header.magic, "JKM1", 4);
+        header.channels   = gChannels;
+        header.sampleRate = jackbridge_get_sample_rate(jClient);
+        header.interval   = gLevelInterval;
+
+        return write_all(fd, &header, sizeof(header));
+    }
+
+    char line[256];
+    const int size = std::snprintf(line, sizeof(line),
+                                   "# cadence-jackmeter %s, %i channels at %u Hz, every %u frames\n"
+                                   "# frame peak1 rms1 peak2 rms2 ... (dBFS)\n",
+                                   VERSION, gChannels, jackbridge_get_sample_rate(jClient), gLevelInterval);
+
+    return write_all(fd, line, size_t(size));
+}
+
+static bool write_record(const int fd, const uint8_t* const record, char* const line)
+{
+    if (x_isBinary)
+        return write_all(fd, record, gLevelRecordSize);
+
+    const LevelRecordHeader* const header = (const LevelRecordHeader*)record;
+    const float* const levels = (const float*)(record + sizeof(LevelRecordHeader));
+
+    int size = 0;
+
+    if (header->dropped > 0)
+        size += std::sprintf(line, "# dropped %u\n", header->dropped);
+
+    size += std::sprintf(line+size, "%llu", (unsigned long long)header->frame);
+
+    for (int i=0; i < gChannels*2; ++i)
+    {
+        if (levels[i] > 0.0f)
+            size += std::sprintf(line+size, " %.2f", 20.0 * std::log10(levels[i]));
+        else
+            size += std::sprintf(line+size, " -inf");
+    }
+
+    line[size++] = '\n';
+
+    return write_all(fd, line, size_t(size));
+}
+
+static int run_headless()
+{
+    std::signal(SIGINT, signal_handler);
+    std::signal(SIGTERM, signal_handler);
+    std::signal(SIGPIPE, SIG_IGN);
+
+    const bool useSocket = ! gSocketPath.isEmpty();
+    int fd = STDOUT_FILENO;
+
+    if (useSocket && (fd = open_socket(gSocketPath)) < 0)
+    {
+        qCritical("Could not connect to socket '%s'", gSocketPath.toLocal8Bit().constData());
+        return 1;
+    }
+
+    if (! write_stream_header(fd))
+        return 1;
+
+    // enough for the dropped notice, the frame and 2 levels per channel
+    char* const line = new char[64 + gChannels*2*16];
+    uint8_t* const record = new uint8_t[gLevelRecordSize];
+
+    // drain at least twice per record, but never sleep long enough to miss a quit request
+    const useconds_t sleepTime = (500000/gLevelRate < 20000) ? 500000/gLevelRate : 20000;
+    int reconnectCountdown = 0;
+
+    while (! x_quitNow)
+    {
+        while (gLevelRing.read(record, gLevelRecordSize))
+        {
+            // records are still taken out while the socket is gone, the RT thread only sees free space
+            if (fd < 0 || write_record(fd, record, line))
+                continue;
+
+            if (! useSocket)
+            {
+                // nobody is reading stdout anymore
+                x_quitNow = true;
+                break;
+            }
+
+            qWarning("Lost connection to socket '%s', retrying", gSocketPath.toLocal8Bit().constData());
+            ::close(fd);
+            fd = -1;
+            reconnectCountdown = 0;
+        }
+
+        if (fd < 0 && --reconnectCountdown <= 0)
+        {
+            if ((fd = open_socket(gSocketPath)) >= 0 && ! write_stream_header(fd))
+            {
+                ::close(fd);
+                fd = -1;
+            }
+
+            // about once per second
+            reconnectCountdown = 1000000 / sleepTime;
+        }
+
+        if (x_needReconnect)
+            connect_pending_ports();
+
+        usleep(sleepTime);
+    }
+
+    if (useSocket && fd >= 0)
+        ::close(fd);
+
+    delete[] line;
+    delete[] record;
+
+    return 0;
+}
+#endif
+
+// -------------------------------
+
+static void show_error(const QString& text)
+{
+    if (x_isHeadless)
+        qCritical("%s", text.toUtf8().constData());
+    else
+        QMessageBox::critical(nullptr, QCoreApplication::translate("MeterW", "Error"), text);
+}
+
+static bool parse_int_arg(const QStringList& args, const char* const name, const int minimum, const int maximum, int& value)
+{
+    const int index = args.indexOf(name);
+
+    if (index < 0)
+        return true;
+
+    bool ok = false;
+    const int newValue = args.value(index+1).toInt(&ok);
+
+    if (! ok || newValue < minimum || newValue > maximum)
+    {
+        show_error(QCoreApplication::translate("MeterW", "Invalid value for %1, must be between %2 and %3").arg(name).arg(minimum).arg(maximum));
+        return false;
+    }
+
+    value = newValue;
+    return true;
+}
+
+static bool parse_args(const QStringList& args)
+{
+    if (args.contains("-in"))
         x_isOutput = false;
 
-    // JACK initialization
+    if (args.contains("-truepeak"))
+        x_isTruePeak = true;
+
+    if (args.contains("-loudness"))
+        x_isLoudness = true;
+
+    if (args.contains("-binary"))
+        x_isBinary = true;
+
+    if (args.contains("-rms"))
+    {
+        x_hasBallistics = true;
+        gBallisticsMode = LevelBallistics::MODE_RMS;
+    }
+    else if (args.contains("-vu"))
+    {
+        x_hasBallistics = true;
+        gBallisticsMode = LevelBallistics::MODE_VU;
+    }
+    else if (args.contains("-ppm1"))
+    {
+        x_hasBallistics = true;
+        gBallisticsMode = LevelBallistics::MODE_PPM_TYPE_I;
+    }
+    else if (args.contains("-ppm2"))
+    {
+        x_hasBallistics = true;
+        gBallisticsMode = LevelBallistics::MODE_PPM_TYPE_II;
+    }
+
+    // ballistics work on the plain samples, the oversampled peak would be computed and thrown away
+    if (x_hasBallistics && x_isTruePeak)
+    {
+        show_error(QCoreApplication::translate("MeterW", "-truepeak can't be combined with -rms, -vu, -ppm1 or -ppm2"));
+        return false;
+    }
+
+    // the headless record only has peak and RMS, these would be silently dropped
+    if (x_isHeadless && (x_hasBallistics || x_isLoudness))
+    {
+        show_error(QCoreApplication::translate("MeterW", "-headless can't be combined with -rms, -vu, -ppm1, -ppm2 or -loudness"));
+        return false;
+    }
+
+    // only the headless writer streams levels, the GUI would silently ignore these
+    if (! x_isHeadless && (x_isBinary || args.contains("-socket")))
+    {
+        show_error(QCoreApplication::translate("MeterW", "-socket and -binary can only be used with -headless"));
+        return false;
+    }
+
+    const int socketIndex = args.indexOf("-socket");
+
+    if (socketIndex >= 0)
+        gSocketPath = args.value(socketIndex+1);
+
+    return parse_int_arg(args, "-channels", 1, kMaxChannels, gChannels) && parse_int_arg(args, "-rate", 1, 1000, gLevelRate);
+}
+
+static bool init_jack(const char* const sessionArg)
+{
     jack_status_t jStatus;
 #ifdef HAVE_JACKSESSION
     jack_options_t jOptions = static_cast<jack_options_t>(JackNoStartServer|JackUseExactName|JackSessionID);
@@ -225,37 +821,148 @@ int main(int argc, char* argv[])
     if (! jClient)
     {
         std::string errorString(jackbridge_status_get_error_string(jStatus));
-        QMessageBox::critical(nullptr, app.translate("MeterW", "Error"), app.translate("MeterW",
-                                                                                       "Could not connect to JACK, possible reasons:\n"
-                                                                                       "%1").arg(QString::fromStdString(errorString)));
-        return 1;
+        show_error(QCoreApplication::translate("MeterW",
+                                               "Could not connect to JACK, possible reasons:\n"
+                                               "%1").arg(QString::fromStdString(errorString)));
+        return false;
     }
 
     gClientName = jackbridge_get_client_name(jClient);
 
-    jPort1 = jackbridge_port_register(jClient, "in1", JACK_DEFAULT_AUDIO_TYPE, JackPortIsInput, 0);
-    jPort2 = jackbridge_port_register(jClient, "in2", JACK_DEFAULT_AUDIO_TYPE, JackPortIsInput, 0);
+    const jack_nframes_t sampleRate = jackbridge_get_sample_rate(jClient);
+
+    jPorts = new jack_port_t*[gChannels];
+    gConnections = new ChannelConnections[gChannels];
+    gPeaks.setCount(gChannels);
+
+    gBuffers = new const float*[gChannels];
+
+    if (x_isTruePeak)
+        gTruePeaks = new TruePeakDetector[gChannels];
+
+    if (x_hasBallistics)
+        gBallistics.setup(gChannels, sampleRate, gBallisticsMode);
+
+    if (x_isLoudness)
+        gLoudness.setup(gChannels, sampleRate);
+
+    if (x_isHeadless)
+    {
+        gLevelInterval   = (sampleRate / gLevelRate > 0) ? sampleRate / gLevelRate : 1;
+        gLevelRecordSize = sizeof(LevelRecordHeader) + sizeof(float)*gChannels*2;
+
+        gLevelPeaks  = new float[gChannels];
+        gLevelSums   = new double[gChannels];
+        gLevelRecord = new uint8_t[gLevelRecordSize];
+
+        for (int i=0; i < gChannels; ++i)
+        {
+            gLevelPeaks[i] = 0.0f;
+            gLevelSums[i]  = 0.0;
+        }
+
+        // about a second of records, the writer can stall that long before anything is dropped
+        gLevelRing.setSize(gLevelRecordSize * (gLevelRate > 16 ? gLevelRate : 16));
+    }
+
+    for (int i=0; i < gChannels; ++i)
+        jPorts[i] = jackbridge_port_register(jClient, QString("in%1").arg(i+1).toUtf8().constData(), JACK_DEFAULT_AUDIO_TYPE, JackPortIsInput, 0);
 
     jackbridge_set_process_callback(jClient, process_callback, nullptr);
     jackbridge_set_port_connect_callback(jClient, port_callback, nullptr);
 #ifdef HAVE_JACKSESSION
-    jackbridge_set_session_callback(jClient, session_callback, argv[0]);
+    jackbridge_set_session_callback(jClient, session_callback, (void*)sessionArg);
+#else
+    Q_UNUSED(sessionArg);
 #endif
     jackbridge_activate(jClient);
 
     reconnect_ports();
 
+    return true;
+}
+
+static void close_jack()
+{
+    jackbridge_deactivate(jClient);
+    jackbridge_client_close(jClient);
+
+    delete[] jPorts;
+    delete[] gConnections;
+    delete[] gBuffers;
+
+    if (gTruePeaks != nullptr)
+        delete[] gTruePeaks;
+
+    if (gLevelPeaks != nullptr)
+        delete[] gLevelPeaks;
+    if (gLevelSums != nullptr)
+        delete[] gLevelSums;
+    if (gLevelRecord != nullptr)
+        delete[] gLevelRecord;
+}
+
+// -------------------------------
+
+int main(int argc, char* argv[])
+{
+    // no display on render nodes, check for headless mode before Qt tries to open one
+    for (int i=1; i < argc; ++i)
+    {
+        if (std::strcmp(argv[i], "-headless") == 0)
+            x_isHeadless = true;
+    }
+
+    if (x_isHeadless)
+    {
+#ifdef Q_OS_WIN
+        show_error("Headless mode is not available on this platform");
+        return 1;
+#else
+        QStringList args;
+
+        for (int i=0; i < argc; ++i)
+            args.append(QString::fromLocal8Bit(argv[i]));
+
+        peak_detect_init();
+        true_peak_init();
+
+        if (! (parse_args(args) && init_jack(argv[0])))
+            return 1;
+
+        const int ret = run_headless();
+
+        close_jack();
+
+        return ret;
+#endif
+    }
+
+    QApplication app(argc, argv);
+    app.setApplicationName("JackMeter");
+    app.setApplicationVersion(VERSION);
+    app.setOrganizationName("Cadence");
+    app.setWindowIcon(QIcon(":/scalable/cadence.svg"));
+
+    if (! parse_args(app.arguments()))
+        return 1;
+
+    peak_detect_init();
+    true_peak_init();
+
+    if (! init_jack(argv[0]))
+        return 1;
+
     // Show GUI
     MeterW gui;
-    gui.resize(70, 600);
+    gui.resize(gChannels > 2 ? gChannels*35/2 : 70, 600);
     gui.show();
     gui.setAttribute(Qt::WA_QuitOnClose);
 
     // App-Loop
     int ret = app.exec();
 
-    jackbridge_deactivate(jClient);
-    jackbridge_client_close(jClient);
+    close_jack();
 
     return ret;
 }
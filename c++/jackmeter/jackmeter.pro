@@ -15,10 +15,20 @@ VERSION  = 0.5.0
 
 SOURCES  = \
     jackmeter.cpp \
+    ../dsp/ballistics.cpp \
+    ../dsp/loudness.cpp \
+    ../dsp/peakdetect.cpp \
+    ../dsp/truepeak.cpp \
     ../widgets/digitalpeakmeter.cpp
 
 HEADERS  = \
     ../jack_utils.hpp \
+    ../peak_store.hpp \
+    ../ring_buffer.hpp \
+    ../dsp/ballistics.hpp \
+    ../dsp/loudness.hpp \
+    ../dsp/peakdetect.hpp \
+    ../dsp/truepeak.hpp \
     ../widgets/digitalpeakmeter.hpp
 
 INCLUDEPATH = \
@@ -1,6 +1,6 @@
 /*
  * Simple Queue, specially developed for MIDI messages
- * Copyright (C) 2012 Filipe Coelho <falktx@falktx.com>
+ * Copyright (C) 2012-2026 Filipe Coelho <falktx@falktx.com>
  *
  * This program is free software; you can redistribute it and/or modify
  * it under the terms of the GNU General Public License as published by
@@ -18,142 +18,449 @@
 #ifndef MIDI_QUEUE_HPP
 #define MIDI_QUEUE_HPP
 
+#include <atomic>
 #include <cstring>
-#include <QtCore/QMutex>
-
-class Queue
+#include <stdint.h>
+#include <QtCore/QtGlobal>
+
+// Fixed size ring for one producer and one consumer thread, never blocks and never allocates.
+// The indexes are free-running counters, masked on access, so all SIZE slots can be used.
+// Each side only writes its own index: release after touching a slot, acquire before reading the other side's.
+// When full the new value is dropped and counted, queued values are never touched by the producer.
+template<typename T, uint32_t SIZE>
+class LockFreeQueue
 {
+    static_assert(SIZE > 0 && (SIZE & (SIZE-1)) == 0, "LockFreeQueue size must be a power of two");
+
 public:
-    Queue()
+    static const uint32_t kSize = SIZE;
+
+    LockFreeQueue()
+        : fDropped(0),
+          fWriteIndex(0),
+          fReadIndex(0) {}
+
+    // producer thread, returns false if a value was dropped
+    bool put(const T& value)
     {
-        index = 0;
-        empty = true;
-        full  = false;
+        const uint32_t writeIndex = fWriteIndex.load(std::memory_order_relaxed);
+
+        if (writeIndex - fReadIndex.load(std::memory_order_acquire) == SIZE)
+        {
+            fDropped.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+
+        fData[writeIndex & (SIZE-1)].store(value, std::memory_order_relaxed);
+        fWriteIndex.store(writeIndex + 1, std::memory_order_release);
+        return true;
     }
 
-    void copyDataFrom(Queue* queue)
+    // consumer thread, returns false if the queue is empty
+    bool get(T& value)
     {
-        // lock mutexes
-        queue->mutex.lock();
-        mutex.lock();
+        const uint32_t readIndex = fReadIndex.load(std::memory_order_relaxed);
+
+        if (fWriteIndex.load(std::memory_order_acquire) == readIndex)
+            return false;
 
-        // copy data from queue
-        ::memcpy(data, queue->data, sizeof(datatype)*MAX_SIZE);
-        index = queue->index;
-        empty = queue->empty;
-        full  = queue->full;
+        value = fData[readIndex & (SIZE-1)].load(std::memory_order_relaxed);
+        fReadIndex.store(readIndex + 1, std::memory_order_release);
+        return true;
+    }
+
+    // consumer thread, takes up to 'maxCount' values at once, oldest first; returns how many
+    // only touches the slots that are filled, no matter how big the queue is
+    uint32_t drain(T* const values, const uint32_t maxCount)
+    {
+        const uint32_t readIndex = fReadIndex.load(std::memory_order_relaxed);
+        uint32_t count = fWriteIndex.load(std::memory_order_acquire) - readIndex;
 
-        // unlock our mutex, no longer needed
-        mutex.unlock();
+        if (count > maxCount)
+            count = maxCount;
 
-        // reset queque
-        ::memset(queue->data, 0, sizeof(datatype)*MAX_SIZE);
-        queue->index = 0;
-        queue->empty = true;
-        queue->full  = false;
+        for (uint32_t i=0; i < count; ++i)
+            values[i] = fData[(readIndex + i) & (SIZE-1)].load(std::memory_order_relaxed);
 
-        // unlock queque mutex
-        queue->mutex.unlock();
+        if (count != 0)
+            fReadIndex.store(readIndex + count, std::memory_order_release);
+
+        return count;
     }
 
-    bool isEmpty()
+    // any thread, only a hint while the other side is running
+    uint32_t getCount() const
     {
-        return empty;
+        const uint32_t readIndex = fReadIndex.load(std::memory_order_acquire);
+        const uint32_t count = fWriteIndex.load(std::memory_order_acquire) - readIndex;
+
+        return (count < SIZE) ? count : SIZE;
     }
 
-    bool isFull()
+    bool isEmpty() const
     {
-        return full;
+        return getCount() == 0;
     }
 
-    void lock()
+    bool isFull() const
     {
-        mutex.lock();
+        return getCount() == SIZE;
     }
 
-    void unlock()
+    // any thread, values lost to the full policy so far
+    uint32_t getDroppedCount() const
     {
-        mutex.unlock();
+        return fDropped.load(std::memory_order_relaxed);
     }
 
-    void put(unsigned char d1, unsigned char d2, unsigned char d3, bool lock = true)
+private:
+    std::atomic<uint32_t> fDropped;
+
+    std::atomic<T> fData[SIZE];
+
+    // padded apart, so the two threads don't keep stealing each other's cache line
+    std::atomic<uint32_t> fWriteIndex;
+    char fPadding[64];
+    std::atomic<uint32_t> fReadIndex;
+
+    LockFreeQueue(const LockFreeQueue&);
+    LockFreeQueue& operator=(const LockFreeQueue&);
+};
+
+// -------------------------------
+
+// 8 bytes, so the atomic slots stay lock-free
+struct MidiData {
+    unsigned char d1, d2, d3, reserved;
+    uint32_t time; // JACK frame time
+};
+
+// Short MIDI messages, one writer thread and one reader thread
+class Queue : public LockFreeQueue<MidiData, 512>
+{
+public:
+    bool put(const unsigned char d1, const unsigned char d2, const unsigned char d3, const uint32_t time = 0)
     {
         Q_ASSERT(d1 != 0);
 
-        if (full || d1 == 0)
-            return;
+        if (d1 == 0)
+            return false;
+
+        MidiData data;
+        data.d1 = d1;
+        data.d2 = d2;
+        data.d3 = d3;
+        data.reserved = 0;
+        data.time = time;
 
-        if (lock)
-            mutex.lock();
+        return LockFreeQueue<MidiData, 512>::put(data);
+    }
+
+    bool get(unsigned char* const d1, unsigned char* const d2, unsigned char* const d3, uint32_t* const time = nullptr)
+    {
+        Q_ASSERT(d1 && d2 && d3);
+
+        MidiData data;
+
+        if (! LockFreeQueue<MidiData, 512>::get(data))
+            return false;
+
+        *d1 = data.d1;
+        *d2 = data.d2;
+        *d3 = data.d3;
+
+        if (time != nullptr)
+            *time = data.time;
+
+        return true;
+    }
+};
+
+// -------------------------------
+
+// How a controller value is sent.
+// JACK MIDI ports carry MIDI 1.0 bytes, so there's no MIDI 2.0 (UMP) 32-bit controller message to send;
+// 14-bit CC pairs and NRPN are the high-resolution forms a MIDI 1.0 receiver understands.
+enum ControlResolution {
+    CONTROL_7BIT  = 0, // one CC, value 0-127
+    CONTROL_14BIT = 1, // MSB on CC 0-31 then LSB on CC+32, value 0-16383
+    CONTROL_NRPN  = 2  // NRPN number select (99, 98) then data entry (6, 38), value 0-16383
+};
 
-        for (unsigned short i=0; i < MAX_SIZE; i++)
+// Latest value of every (channel, CC) pair, so a burst of moves goes out as one event per pair.
+// Writers set values whenever they want, one reader thread takes what changed once per period.
+// put() is only atomic stores, so more than one thread may write; for the same pair the last one wins.
+//
+// Each pair is a 64-bit atomic holding value, resolution and time, so they're always read together,
+// and each channel has a bitmask of the controls set since the last drain.
+// All the CCs that make up one value come from the same entry, so they go out together and in order.
+// A value set while draining may go out twice, once now and once next time, but never gets lost.
+class ControlChangeCoalescer
+{
+public:
+    // worst case, every control set as NRPN
+    static const uint32_t kMaxEvents = 16*128*4;
+
+    ControlChangeCoalescer()
+        : fInterval(0),
+          fFramesLeft(0)
+    {
+        for (int i=0; i < 16*128; ++i)
+            fValues[i].store(0, std::memory_order_relaxed);
+        for (int i=0; i < 16*2; ++i)
+            fDirty[i].store(0, std::memory_order_relaxed);
+    }
+
+    // any thread, minimum frames between drains; 0 sends changes every period
+    void setInterval(const uint32_t frames)
+    {
+        fInterval.store(frames, std::memory_order_relaxed);
+    }
+
+    // any thread, channel is 0-15; value range depends on the resolution
+    void put(const unsigned char channel, const unsigned char control, const uint16_t value, const ControlResolution resolution, const uint32_t time)
+    {
+        Q_ASSERT(channel < 16 && control < 128);
+        Q_ASSERT(resolution != CONTROL_14BIT || control < 0x20);
+
+        const uint32_t index = (channel << 7) | control;
+
+        fValues[index].store((uint64_t(time) << 32) | (uint32_t(resolution) << 14) | (value & 0x3FFF), std::memory_order_relaxed);
+        fDirty[index >> 6].fetch_or(uint64_t(1) << (index & 63), std::memory_order_release);
+    }
+
+    // reader thread, call once per period; writes CC events into 'events' and returns how many.
+    // Whatever doesn't fit in 'maxCount' stays marked and goes out on the next call,
+    // the interval only starts again once everything was sent.
+    uint32_t drain(MidiData* const events, const uint32_t maxCount, const uint32_t nframes)
+    {
+        const uint32_t interval = fInterval.load(std::memory_order_relaxed);
+
+        if (fFramesLeft > nframes)
+        {
+            fFramesLeft -= nframes;
+            return 0;
+        }
+
+        // the interval only starts counting once something was sent
+        fFramesLeft = 0;
+
+        uint32_t count = 0;
+
+        for (uint32_t i=0; i < 16*2; ++i)
         {
-            if (data[i].d1 == 0)
+            if (fDirty[i].load(std::memory_order_relaxed) == 0)
+                continue;
+
+            uint64_t dirty = fDirty[i].exchange(0, std::memory_order_acquire);
+
+            while (dirty != 0)
             {
-                data[i].d1 = d1;
-                data[i].d2 = d2;
-                data[i].d3 = d3;
-                empty = false;
-                full  = (i == MAX_SIZE-1);
-                break;
+                const uint32_t bit   = __builtin_ctzll(dirty);
+                const uint32_t index = (i << 6) | bit;
+                const uint64_t entry = fValues[index].load(std::memory_order_relaxed);
+
+                const unsigned char status  = 0xB0 | (index >> 7);
+                const unsigned char control = index & 0x7F;
+                const uint32_t value = entry & 0x3FFF;
+                const uint32_t time  = uint32_t(entry >> 32);
+
+                const ControlResolution resolution = ControlResolution((entry >> 14) & 0x3);
+                const uint32_t needed = (resolution == CONTROL_NRPN) ? 4 : (resolution == CONTROL_14BIT) ? 2 : 1;
+
+                if (count + needed > maxCount)
+                {
+                    fDirty[i].fetch_or(dirty, std::memory_order_relaxed);
+                    return count;
+                }
+
+                switch (resolution)
+                {
+                case CONTROL_7BIT:
+                    setEvent(events[count++], status, control, value, time);
+                    break;
+                case CONTROL_14BIT:
+                    setEvent(events[count++], status, control, value >> 7, time);
+                    setEvent(events[count++], status, control + 0x20, value & 0x7F, time);
+                    break;
+                case CONTROL_NRPN:
+                    setEvent(events[count++], status, 99, 0, time);
+                    setEvent(events[count++], status, 98, control, time);
+                    setEvent(events[count++], status, 6, value >> 7, time);
+                    setEvent(events[count++], status, 38, value & 0x7F, time);
+                    break;
+                }
+
+                dirty &= dirty - 1;
             }
         }
 
-        if (lock)
-            mutex.unlock();
+        if (count != 0)
+            fFramesLeft = interval;
+
+        return count;
     }
 
-    bool get(unsigned char* d1, unsigned char* d2, unsigned char* d3, bool lock = true)
+private:
+    std::atomic<uint32_t> fInterval;
+    uint32_t fFramesLeft; // reader thread only
+
+    std::atomic<uint64_t> fValues[16*128];
+    std::atomic<uint64_t> fDirty[16*2];
+
+    static void setEvent(MidiData& event, const unsigned char status, const unsigned char control, const unsigned char value, const uint32_t time)
     {
-        Q_ASSERT(d1 && d2 && d3);
+        event.d1 = status;
+        event.d2 = control;
+        event.d3 = value & 0x7F;
+        event.reserved = 0;
+        event.time = time;
+    }
 
-        if (empty || ! (d1 && d2 && d3))
-            return false;
+    ControlChangeCoalescer(const ControlChangeCoalescer&);
+    ControlChangeCoalescer& operator=(const ControlChangeCoalescer&);
+};
 
-        if (lock)
-            mutex.lock();
+// -------------------------------
 
-        full = false;
+// Header of one MidiEventRing record, the event bytes follow it
+struct MidiEventRecord {
+    uint32_t time; // JACK frame time
+    uint32_t size; // bytes of data
 
-        if (data[index].d1 == 0)
-        {
-            index = 0;
-            empty = true;
+    const unsigned char* getData() const
+    {
+        return reinterpret_cast<const unsigned char*>(this + 1);
+    }
+};
+
+// MIDI events of any size (SysEx, realtime and channel messages),
+// one writer thread and one reader thread, never blocks and never allocates.
+//
+// Records are a MidiEventRecord plus the data, padded to 8 bytes and always contiguous:
+// if one does not fit before the end of the buffer a wrap marker is left there and it starts over at 0.
+// That way the reader gets a pointer into the ring instead of a copy, see peek() and pop().
+// When full, new events are dropped and counted.
+template<uint32_t SIZE>
+class MidiEventRing
+{
+    static_assert(SIZE >= 64 && (SIZE & (SIZE-1)) == 0, "MidiEventRing size must be a power of two");
+
+public:
+    // biggest event that always fits in an empty ring
+    static const uint32_t kMaxEventSize = SIZE/2 - sizeof(MidiEventRecord);
 
-            if (lock)
-                mutex.unlock();
+    MidiEventRing()
+        : fDropped(0),
+          fWritePos(0),
+          fReadPos(0) {}
 
+    // writer thread, returns false if the event was dropped
+    bool put(const unsigned char* const data, const uint32_t size, const uint32_t time)
+    {
+        Q_ASSERT(data != nullptr);
+
+        if (size == 0 || size > kMaxEventSize)
+        {
+            fDropped.fetch_add(1, std::memory_order_relaxed);
             return false;
         }
 
-        *d1 = data[index].d1;
-        *d2 = data[index].d2;
-        *d3 = data[index].d3;
+        const uint32_t length = getRecordLength(size);
 
-        data[index].d1 = data[index].d2 = data[index].d3 = 0;
-        index++;
-        empty = false;
+        uint32_t writePos = fWritePos.load(std::memory_order_relaxed);
+        const uint32_t space = SIZE - (writePos - fReadPos.load(std::memory_order_acquire));
+        const uint32_t tail  = SIZE - (writePos & (SIZE-1));
 
-        if (lock)
-            mutex.unlock();
+        if (length + ((length > tail) ? tail : 0) > space)
+        {
+            fDropped.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
 
+        if (length > tail)
+        {
+            getRecord(writePos)->size = kWrapMarker;
+            writePos += tail;
+        }
+
+        MidiEventRecord* const record(getRecord(writePos));
+        record->time = time;
+        record->size = size;
+        std::memcpy(record + 1, data, size);
+
+        fWritePos.store(writePos + length, std::memory_order_release);
         return true;
     }
 
+    // reader thread, the oldest event or null if empty; stays valid until pop()
+    const MidiEventRecord* peek()
+    {
+        uint32_t readPos = fReadPos.load(std::memory_order_relaxed);
+
+        if (fWritePos.load(std::memory_order_acquire) == readPos)
+            return nullptr;
+
+        const MidiEventRecord* record(getRecord(readPos));
+
+        // the writer publishes a wrap marker together with the record after it, so that one is there too
+        if (record->size == kWrapMarker)
+        {
+            readPos += SIZE - (readPos & (SIZE-1));
+            fReadPos.store(readPos, std::memory_order_release);
+            record = getRecord(readPos);
+        }
+
+        return record;
+    }
+
+    // reader thread, releases the event returned by peek()
+    void pop()
+    {
+        const uint32_t readPos = fReadPos.load(std::memory_order_relaxed);
+
+        Q_ASSERT(fWritePos.load(std::memory_order_acquire) != readPos);
+        Q_ASSERT(getRecord(readPos)->size != kWrapMarker);
+
+        fReadPos.store(readPos + getRecordLength(getRecord(readPos)->size), std::memory_order_release);
+    }
+
+    bool isEmpty() const
+    {
+        return fWritePos.load(std::memory_order_acquire) == fReadPos.load(std::memory_order_acquire);
+    }
+
+    // any thread, events lost because they did not fit
+    uint32_t getDroppedCount() const
+    {
+        return fDropped.load(std::memory_order_relaxed);
+    }
+
 private:
-    struct datatype {
-        unsigned char d1, d2, d3;
+    static const uint32_t kWrapMarker = 0xFFFFFFFF;
 
-        datatype()
-            : d1(0), d2(0), d3(0) {}
-    };
+    std::atomic<uint32_t> fDropped;
 
-    static const unsigned short MAX_SIZE = 512;
-    datatype data[MAX_SIZE];
-    unsigned short index;
-    bool empty, full;
+    // uint64_t keeps every record 8-byte aligned
+    uint64_t fBuffer[SIZE/8];
+
+    // free-running byte positions, same as in LockFreeQueue
+    std::atomic<uint32_t> fWritePos;
+    char fPadding[64];
+    std::atomic<uint32_t> fReadPos;
+
+    static uint32_t getRecordLength(const uint32_t size)
+    {
+        return (sizeof(MidiEventRecord) + size + 7) & ~uint32_t(7);
+    }
+
+    MidiEventRecord* getRecord(const uint32_t pos)
+    {
+        return reinterpret_cast<MidiEventRecord*>(reinterpret_cast<unsigned char*>(fBuffer) + (pos & (SIZE-1)));
+    }
 
-    QMutex mutex;
+    MidiEventRing(const MidiEventRing&);
+    MidiEventRing& operator=(const MidiEventRing&);
 };
 
 #endif // MIDI_QUEUE_HPP
@@ -18,6 +18,7 @@
 #include "patchcanvas/patchcanvas.cpp"
 #include "patchcanvas/patchcanvas-theme.cpp"
 #include "patchcanvas/patchscene.cpp"
+#include "patchcanvas/canvasarrange.cpp"
 #include "patchcanvas/canvasbezierline.cpp"
 #include "patchcanvas/canvasbezierlinemov.cpp"
 #include "patchcanvas/canvasbox.cpp"
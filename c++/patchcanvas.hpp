@@ -125,6 +125,10 @@ void renamePort(int port_id, QString new_port_name);
 void connectPorts(int connection_id, int port_out_id, int port_in_id);
 void disconnectPorts(int connection_id);
 
+// defer box layouts, new lines and repaints until the outermost endUpdate()
+void beginUpdate();
+void endUpdate();
+
 void arrange();
 void updateZValues();
 
@@ -0,0 +1,495 @@
+/*
+ * Patchbay Canvas engine using QGraphicsView/Scene
+ * Copyright (C) 2010-2026 Filipe Coelho <falktx@falktx.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * For a full copy of the GNU General Public License see the COPYING file
+ */
+
+#include "canvasarrange.h"
+
+#include <algorithm>
+
+START_NAMESPACE_PATCHCANVAS
+
+static const int arrange_layer_gap = 80;
+static const int arrange_box_gap   = 20;
+static const int arrange_line_gap  = 10;
+static const int arrange_sweeps    = 12;
+static const int arrange_dummies   = 8; // per box
+
+static bool arrange_edge_less(const arrange_edge_t& a, const arrange_edge_t& b)
+{
+    return (a.node_out < b.node_out) || (a.node_out == b.node_out && a.node_in < b.node_in);
+}
+
+static bool arrange_edge_equal(const arrange_edge_t& a, const arrange_edge_t& b)
+{
+    return a.node_out == b.node_out && a.node_in == b.node_in;
+}
+
+struct arrange_sort_t {
+    double barycenter;
+    int node;
+
+    bool operator<(const arrange_sort_t& other) const
+    {
+        return barycenter < other.barycenter;
+    }
+};
+
+CanvasArrange::CanvasArrange(QObject* parent) :
+    QThread(parent)
+{
+}
+
+void CanvasArrange::setGraph(const QVector<arrange_node_t>& nodes, const QVector<arrange_edge_t>& edges, const QPointF& origin)
+{
+    m_nodes  = nodes;
+    m_edges  = edges;
+    m_origin = origin;
+}
+
+QVector<QPointF> CanvasArrange::getPositions() const
+{
+    return m_positions;
+}
+
+void CanvasArrange::run()
+{
+    m_positions.clear();
+
+    if (m_nodes.isEmpty())
+        return;
+
+    QVector<arrange_edge_t> dag;
+
+    removeCycles(dag);
+    assignRanks(dag);
+    buildLayers(dag);
+    reduceCrossings();
+    assignCoordinates();
+}
+
+// Depth-first search from the sources, edges going back to a node still on the stack get reversed
+void CanvasArrange::removeCycles(QVector<arrange_edge_t>& dag)
+{
+    const int count = m_nodes.count();
+
+    // skip self connections and keep one edge per pair of boxes
+    QVector<arrange_edge_t> edges;
+    for (int i=0; i < m_edges.count(); i++)
+    {
+        if (m_edges[i].node_out != m_edges[i].node_in)
+            edges.append(m_edges[i]);
+    }
+
+    std::sort(edges.begin(), edges.end(), arrange_edge_less);
+    edges.erase(std::unique(edges.begin(), edges.end(), arrange_edge_equal), edges.end());
+
+    QVector<QVector<int> > out(count);
+    QVector<int> in_count(count, 0);
+
+    for (int i=0; i < edges.count(); i++)
+    {
+        out[edges[i].node_out].append(edges[i].node_in);
+        in_count[edges[i].node_in] += 1;
+    }
+
+    QVector<int> roots;
+    for (int i=0; i < count; i++)
+    {
+        if (in_count[i] == 0)
+            roots.append(i);
+    }
+    for (int i=0; i < count; i++)
+    {
+        if (in_count[i] != 0)
+            roots.append(i);
+    }
+
+    // 0 = not visited, 1 = on the stack, 2 = done
+    QVector<int> state(count, 0);
+    QVector<int> stack_node;
+    QVector<int> stack_edge;
+
+    for (int r=0; r < roots.count(); r++)
+    {
+        if (state[roots[r]] != 0)
+            continue;
+
+        state[roots[r]] = 1;
+        stack_node.append(roots[r]);
+        stack_edge.append(0);
+
+        while (! stack_node.isEmpty())
+        {
+            const int node = stack_node.last();
+            const int next = stack_edge.last();
+
+            if (next == out[node].count())
+            {
+                state[node] = 2;
+                stack_node.pop_back();
+                stack_edge.pop_back();
+                continue;
+            }
+
+            stack_edge.last() += 1;
+
+            const int target = out[node][next];
+            arrange_edge_t edge;
+
+            if (state[target] == 1)
+            {
+                edge.node_out = target;
+                edge.node_in  = node;
+            }
+            else
+            {
+                edge.node_out = node;
+                edge.node_in  = target;
+            }
+
+            dag.append(edge);
+
+            if (state[target] == 0)
+            {
+                state[target] = 1;
+                stack_node.append(target);
+                stack_edge.append(0);
+            }
+        }
+    }
+}
+
+// Longest path from the sources, then hardware playback goes to the last rank and other sources sit next to their targets
+void CanvasArrange::assignRanks(const QVector<arrange_edge_t>& dag)
+{
+    const int count = m_nodes.count();
+
+    QVector<QVector<int> > out(count);
+    QVector<int> in_count(count, 0);
+
+    for (int i=0; i < dag.count(); i++)
+    {
+        out[dag[i].node_out].append(dag[i].node_in);
+        in_count[dag[i].node_in] += 1;
+    }
+
+    QVector<int> pending(in_count);
+    QVector<int> queue;
+
+    for (int i=0; i < count; i++)
+    {
+        if (pending[i] == 0)
+            queue.append(i);
+    }
+
+    m_rank = QVector<int>(count, 0);
+    int max_rank = 0;
+
+    for (int i=0; i < queue.count(); i++)
+    {
+        const int node = queue[i];
+
+        foreach (const int& target, out[node])
+        {
+            if (m_rank[node]+1 > m_rank[target])
+                m_rank[target] = m_rank[node]+1;
+
+            if (--pending[target] == 0)
+                queue.append(target);
+        }
+
+        if (m_rank[node] > max_rank)
+            max_rank = m_rank[node];
+    }
+
+    for (int i=0; i < count; i++)
+    {
+        if (in_count[i] == 0 && out[i].count() > 0 && ! m_nodes[i].hardware)
+        {
+            int min_rank = max_rank;
+            foreach (const int& target, out[i])
+            {
+                if (m_rank[target] < min_rank)
+                    min_rank = m_rank[target];
+            }
+            m_rank[i] = min_rank-1;
+        }
+        else if (in_count[i] > 0 && out[i].isEmpty() && m_nodes[i].hardware)
+        {
+            m_rank[i] = max_rank;
+        }
+    }
+}
+
+// Splits edges that span more than one rank with dummy nodes, so every edge joins two neighbour layers.
+// The long edges of a box share one chain of dummies. Edges are split shortest first, up to arrange_dummies
+// per box, the longest ones left after that are kept out of the layout (their lines are still drawn).
+void CanvasArrange::buildLayers(const QVector<arrange_edge_t>& dag)
+{
+    const int count = m_nodes.count();
+    const int max_dummies = count * arrange_dummies;
+
+    m_up   = QVector<QVector<int> >(count);
+    m_down = QVector<QVector<int> >(count);
+
+    QVector<QVector<int> > by_span(count);
+    QVector<QVector<int> > chains(count);
+
+    for (int i=0; i < dag.count(); i++)
+        by_span[m_rank[dag[i].node_in] - m_rank[dag[i].node_out]].append(i);
+
+    for (int span=1; span < count; span++)
+    {
+        foreach (const int& i, by_span[span])
+        {
+            const int source = dag[i].node_out;
+            const int target = dag[i].node_in;
+
+            if (span-1 - chains[source].count() > max_dummies - (m_rank.count() - count))
+                continue;
+
+            int node = source;
+
+            for (int step=1; step < span; step++)
+            {
+                if (chains[source].count() < step)
+                {
+                    const int dummy = m_rank.count();
+                    m_rank.append(m_rank[source]+step);
+                    m_up.append(QVector<int>(1, node));
+                    m_down.append(QVector<int>());
+                    m_down[node].append(dummy);
+                    chains[source].append(dummy);
+                }
+
+                node = chains[source][step-1];
+            }
+
+            m_down[node].append(target);
+            m_up[target].append(node);
+        }
+    }
+
+    int layer_count = 0;
+    for (int i=0; i < m_rank.count(); i++)
+    {
+        if (m_rank[i]+1 > layer_count)
+            layer_count = m_rank[i]+1;
+    }
+
+    m_layers = QVector<QVector<int> >(layer_count);
+    m_order  = QVector<int>(m_rank.count(), 0);
+
+    for (int i=0; i < m_rank.count(); i++)
+    {
+        m_order[i] = m_layers[m_rank[i]].count();
+        m_layers[m_rank[i]].append(i);
+    }
+}
+
+// Barycenter sweeps down and up the layers, keeping the ordering with fewer crossings
+void CanvasArrange::reduceCrossings()
+{
+    const int layer_count = m_layers.count();
+
+    QVector<QVector<int> > best_layers(m_layers);
+    int best_crossings = 0;
+
+    for (int l=0; l < layer_count-1; l++)
+        best_crossings += countCrossings(l);
+
+    for (int sweep=0; sweep < arrange_sweeps && best_crossings > 0; sweep++)
+    {
+        const bool down = (sweep % 2 == 0);
+
+        for (int step=1; step < layer_count; step++)
+        {
+            const int l = down ? step : layer_count-1-step;
+            QVector<int>& layer = m_layers[l];
+
+            QVector<arrange_sort_t> sorted(layer.count());
+
+            for (int i=0; i < layer.count(); i++)
+            {
+                const QVector<int>& neighbours = down ? m_up[layer[i]] : m_down[layer[i]];
+
+                sorted[i].node = layer[i];
+                sorted[i].barycenter = m_order[layer[i]];
+
+                if (neighbours.isEmpty())
+                    continue;
+
+                double sum = 0.0;
+                foreach (const int& neighbour, neighbours)
+                    sum += m_order[neighbour];
+
+                sorted[i].barycenter = sum / neighbours.count();
+            }
+
+            std::stable_sort(sorted.begin(), sorted.end());
+
+            for (int i=0; i < sorted.count(); i++)
+            {
+                layer[i] = sorted[i].node;
+                m_order[layer[i]] = i;
+            }
+        }
+
+        int crossings = 0;
+        for (int l=0; l < layer_count-1; l++)
+            crossings += countCrossings(l);
+
+        if (crossings < best_crossings)
+        {
+            best_crossings = crossings;
+            best_layers = m_layers;
+        }
+    }
+
+    m_layers = best_layers;
+
+    for (int l=0; l < layer_count; l++)
+    {
+        for (int i=0; i < m_layers[l].count(); i++)
+            m_order[m_layers[l][i]] = i;
+    }
+}
+
+// Crossings between a layer and the next one, as inversions of the lower ends of the sorted edges
+int CanvasArrange::countCrossings(int layer)
+{
+    QVector<arrange_edge_t> edges;
+
+    foreach (const int& node, m_layers[layer])
+    {
+        foreach (const int& target, m_down[node])
+        {
+            arrange_edge_t edge;
+            edge.node_out = m_order[node];
+            edge.node_in  = m_order[target];
+            edges.append(edge);
+        }
+    }
+
+    std::sort(edges.begin(), edges.end(), arrange_edge_less);
+
+    // binary indexed tree over the positions in the lower layer
+    const int size = m_layers[layer+1].count();
+    QVector<int> tree(size+1, 0);
+    int crossings = 0;
+
+    for (int i=0; i < edges.count(); i++)
+    {
+        int below = 0;
+        for (int j = edges[i].node_in+1; j > 0; j -= j & -j)
+            below += tree[j];
+
+        crossings += i - below;
+
+        for (int j = edges[i].node_in+1; j <= size; j += j & -j)
+            tree[j] += 1;
+    }
+
+    return crossings;
+}
+
+// One column per layer, boxes stacked in order and pulled towards the boxes they connect to
+void CanvasArrange::assignCoordinates()
+{
+    const int count = m_nodes.count();
+    const int total = m_rank.count();
+    const int layer_count = m_layers.count();
+
+    QVector<double> height(total, 0.0);
+    QVector<double> gap(total, arrange_line_gap);
+
+    for (int i=0; i < count; i++)
+    {
+        height[i] = m_nodes[i].height;
+        gap[i]    = arrange_box_gap;
+    }
+
+    QVector<double> layer_x(layer_count, 0.0);
+    double x = m_origin.x();
+
+    for (int l=0; l < layer_count; l++)
+    {
+        int width = 0;
+        foreach (const int& node, m_layers[l])
+        {
+            if (node < count && m_nodes[node].width > width)
+                width = m_nodes[node].width;
+        }
+
+        layer_x[l] = x;
+        x += (width > 0 ? width : arrange_layer_gap/2) + arrange_layer_gap;
+    }
+
+    QVector<double> y(total, 0.0);
+
+    for (int l=0; l < layer_count; l++)
+    {
+        double top = 0.0;
+        foreach (const int& node, m_layers[l])
+        {
+            y[node] = top;
+            top += height[node] + gap[node];
+        }
+    }
+
+    for (int pass=0; pass < 4; pass++)
+    {
+        const bool down = (pass % 2 == 0);
+
+        for (int step=1; step < layer_count; step++)
+        {
+            const int l = down ? step : layer_count-1-step;
+            double min_top = -1e9;
+
+            foreach (const int& node, m_layers[l])
+            {
+                const QVector<int>& neighbours = down ? m_up[node] : m_down[node];
+                double wanted = y[node];
+
+                if (! neighbours.isEmpty())
+                {
+                    double sum = 0.0;
+                    foreach (const int& neighbour, neighbours)
+                        sum += y[neighbour] + height[neighbour]/2;
+
+                    wanted = sum / neighbours.count() - height[node]/2;
+                }
+
+                y[node] = (wanted > min_top) ? wanted : min_top;
+                min_top = y[node] + height[node] + gap[node];
+            }
+        }
+    }
+
+    double min_y = y[0];
+    for (int i=1; i < count; i++)
+    {
+        if (y[i] < min_y)
+            min_y = y[i];
+    }
+
+    m_positions = QVector<QPointF>(count);
+
+    for (int i=0; i < count; i++)
+        m_positions[i] = QPointF(layer_x[m_rank[i]], y[i] - min_y + m_origin.y());
+}
+
+END_NAMESPACE_PATCHCANVAS
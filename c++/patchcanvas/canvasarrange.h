@@ -0,0 +1,75 @@
+/*
+ * Patchbay Canvas engine using QGraphicsView/Scene
+ * Copyright (C) 2010-2026 Filipe Coelho <falktx@falktx.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * For a full copy of the GNU General Public License see the COPYING file
+ */
+
+#ifndef CANVASARRANGE_H
+#define CANVASARRANGE_H
+
+#include <QtCore/QThread>
+#include <QtCore/QVector>
+
+#include "patchcanvas.h"
+
+START_NAMESPACE_PATCHCANVAS
+
+struct arrange_node_t {
+    int width;
+    int height;
+    bool hardware;
+};
+
+struct arrange_edge_t {
+    int node_out;
+    int node_in;
+};
+
+// Layered (Sugiyama) layout of the canvas boxes, done away from the GUI thread.
+// The graph is a copy, the result is applied by the canvas once the thread finishes.
+class CanvasArrange : public QThread
+{
+public:
+    CanvasArrange(QObject* parent=0);
+
+    void setGraph(const QVector<arrange_node_t>& nodes, const QVector<arrange_edge_t>& edges, const QPointF& origin);
+    QVector<QPointF> getPositions() const;
+
+protected:
+    virtual void run();
+
+private:
+    QVector<arrange_node_t> m_nodes;
+    QVector<arrange_edge_t> m_edges;
+    QPointF m_origin;
+    QVector<QPointF> m_positions;
+
+    // layered graph, real nodes first and then the dummies of long edges
+    QVector<int> m_rank;
+    QVector<QVector<int> > m_layers;
+    QVector<QVector<int> > m_up;
+    QVector<QVector<int> > m_down;
+    QVector<int> m_order;
+
+    void removeCycles(QVector<arrange_edge_t>& dag);
+    void assignRanks(const QVector<arrange_edge_t>& dag);
+    void buildLayers(const QVector<arrange_edge_t>& dag);
+    void reduceCrossings();
+    int countCrossings(int layer);
+    void assignCoordinates();
+};
+
+END_NAMESPACE_PATCHCANVAS
+
+#endif // CANVASARRANGE_H
@@ -25,8 +25,11 @@
 START_NAMESPACE_PATCHCANVAS
 
 CanvasBezierLine::CanvasBezierLine(CanvasPort* item1_, CanvasPort* item2_, QGraphicsItem* parent) :
-    QGraphicsPathItem(parent, canvas.scene)
+    QGraphicsPathItem(parent)
 {
+    if (! parent)
+        canvas.scene->addItem(this);
+
     item1 = item1_;
     item2 = item2_;
 
@@ -18,7 +18,7 @@
 #ifndef CANVASBEZIERLINE_H
 #define CANVASBEZIERLINE_H
 
-#include <QtGui/QGraphicsPathItem>
+#include <QtWidgets/QGraphicsPathItem>
 
 #include "abstractcanvasline.h"
 
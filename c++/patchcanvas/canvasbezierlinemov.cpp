@@ -24,8 +24,11 @@
 START_NAMESPACE_PATCHCANVAS
 
 CanvasBezierLineMov::CanvasBezierLineMov(PortMode port_mode, PortType port_type, QGraphicsItem* parent) :
-    QGraphicsPathItem(parent, canvas.scene)
+    QGraphicsPathItem(parent)
 {
+    if (! parent)
+        canvas.scene->addItem(this);
+
     m_port_mode = port_mode;
     m_port_type = port_type;
 
@@ -18,7 +18,7 @@
 #ifndef CANVASBEZIERLINEMOV_H
 #define CANVASBEZIERLINEMOV_H
 
-#include <QtGui/QGraphicsPathItem>
+#include <QtWidgets/QGraphicsPathItem>
 
 #include "abstractcanvasline.h"
 
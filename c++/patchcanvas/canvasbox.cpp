@@ -19,10 +19,10 @@
 
 #include <QtCore/QTimer>
 #include <QtGui/QCursor>
-#include <QtGui/QInputDialog>
-#include <QtGui/QMenu>
-#include <QtGui/QGraphicsSceneContextMenuEvent>
-#include <QtGui/QGraphicsSceneMouseEvent>
+#include <QtWidgets/QInputDialog>
+#include <QtWidgets/QMenu>
+#include <QtWidgets/QGraphicsSceneContextMenuEvent>
+#include <QtWidgets/QGraphicsSceneMouseEvent>
 #include <QtGui/QPainter>
 
 #include "canvasline.h"
@@ -34,8 +34,11 @@
 START_NAMESPACE_PATCHCANVAS
 
 CanvasBox::CanvasBox(int group_id, QString group_name, Icon icon, QGraphicsItem* parent) :
-    QGraphicsItem(parent, canvas.scene)
+    QGraphicsItem(parent)
 {
+    if (! parent)
+        canvas.scene->addItem(this);
+
     // Save Variables, useful for later
     m_group_id   = group_id;
     m_group_name = group_name;
@@ -58,6 +61,7 @@ CanvasBox::CanvasBox(int group_id, QString group_name, Icon icon, QGraphicsItem*
     // Set Font
     m_font_name = QFont(canvas.theme->box_font_name, canvas.theme->box_font_size, canvas.theme->box_font_state);
     m_font_port = QFont(canvas.theme->port_font_name, canvas.theme->port_font_size, canvas.theme->port_font_state);
+    m_group_name_width = CanvasGetTextWidth(CanvasBoxFont, m_group_name);
 
     // Icon
     icon_svg = new CanvasIcon(icon, group_name, this);
@@ -73,7 +77,7 @@ CanvasBox::CanvasBox(int group_id, QString group_name, Icon icon, QGraphicsItem*
         shadow = 0;
 
     // Final touches
-    setFlags(QGraphicsItem::ItemIsMovable|QGraphicsItem::ItemIsSelectable);
+    setFlags(QGraphicsItem::ItemIsMovable|QGraphicsItem::ItemIsSelectable|QGraphicsItem::ItemSendsGeometryChanges);
 
     // Wait for at least 1 port
     if (options.auto_hide_groups)
@@ -84,6 +88,8 @@ CanvasBox::CanvasBox(int group_id, QString group_name, Icon icon, QGraphicsItem*
 
 CanvasBox::~CanvasBox()
 {
+    CanvasRemoveBoxRect(this);
+
     if (shadow)
         delete shadow;
     delete icon_svg;
@@ -119,6 +125,20 @@ QList<int> CanvasBox::getPortList()
     return m_port_list_ids;
 }
 
+CanvasPort* CanvasBox::getPortAt(const QPointF& scene_pos)
+{
+    for (int i=0; i <= PORT_TYPE_MIDI_ALSA; i++)
+    {
+        foreach (CanvasPort* port, m_port_widgets[i])
+        {
+            if (port->isVisible() && port->sceneBoundingRect().contains(scene_pos))
+                return port;
+        }
+    }
+
+    return 0;
+}
+
 void CanvasBox::setIcon(Icon icon)
 {
     icon_svg->setIcon(icon, m_group_name);
@@ -133,7 +153,8 @@ void CanvasBox::setSplit(bool split, PortMode mode)
 void CanvasBox::setGroupName(QString group_name)
 {
     m_group_name = group_name;
-    updatePositions();
+    m_group_name_width = CanvasGetTextWidth(CanvasBoxFont, m_group_name);
+    CanvasUpdateBox(this);
 }
 
 void CanvasBox::setShadowOpacity(float opacity)
@@ -165,6 +186,7 @@ CanvasPort* CanvasBox::addPortFromGroup(int port_id, QString port_name, PortMode
     port_dict.widget    = new_widget;
 
     m_port_list_ids.append(port_id);
+    m_port_widgets[port_type].append(new_widget);
 
     return new_widget;
 }
@@ -174,6 +196,18 @@ void CanvasBox::removePortFromGroup(int port_id)
     if (m_port_list_ids.contains(port_id))
     {
         m_port_list_ids.removeOne(port_id);
+
+        for (int i=0; i <= PORT_TYPE_MIDI_ALSA; i++)
+        {
+            for (int j=0; j < m_port_widgets[i].count(); j++)
+            {
+                if (m_port_widgets[i][j]->getPortId() == port_id)
+                {
+                    m_port_widgets[i].removeAt(j);
+                    break;
+                }
+            }
+        }
     }
     else
     {
@@ -183,7 +217,7 @@ void CanvasBox::removePortFromGroup(int port_id)
 
     if (m_port_list_ids.count() > 0)
     {
-        updatePositions();
+        CanvasUpdateBox(this);
     }
     else if (isVisible())
     {
@@ -252,89 +286,47 @@ void CanvasBox::updatePositions()
     int max_in_height  = 24;
     int max_out_width  = 0;
     int max_out_height = 24;
-    bool have_audio_jack_in, have_audio_jack_out, have_midi_jack_in, have_midi_jack_out;
-    bool have_midi_a2j_in,  have_midi_a2j_out, have_midi_alsa_in,  have_midi_alsa_out;
-    have_audio_jack_in  = have_midi_jack_in  = have_midi_a2j_in  = have_midi_alsa_in  = false;
-    have_audio_jack_out = have_midi_jack_out = have_midi_a2j_out = have_midi_alsa_out = false;
 
     // reset box size
     p_width  = 50;
     p_height = 25;
 
     // Check Text Name size
-    int app_name_size = QFontMetrics(m_font_name).width(m_group_name)+30;
+    int app_name_size = m_group_name_width+30;
     if (app_name_size > p_width)
         p_width = app_name_size;
 
-    // Get Port List
-    QList<port_dict_t> port_list;
-    foreach (const port_dict_t& port, canvas.port_list)
+    // Get Max Box Width/Height, text widths are cached by each port
+    for (int i=0; i <= PORT_TYPE_MIDI_ALSA; i++)
     {
-        if (m_port_list_ids.contains(port.port_id))
-            port_list.append(port);
-    }
+        bool have_in  = false;
+        bool have_out = false;
 
-    // Get Max Box Width/Height
-    foreach (const port_dict_t& port, port_list)
-    {
-        if (port.port_mode == PORT_MODE_INPUT)
+        foreach (CanvasPort* port, m_port_widgets[i])
         {
-            max_in_height += 18;
-
-            int size = QFontMetrics(m_font_port).width(port.port_name);
-            if (size > max_in_width)
-                max_in_width = size;
-
-            if (port.port_type == PORT_TYPE_AUDIO_JACK && have_audio_jack_in == false)
-            {
-                have_audio_jack_in = true;
-                max_in_height += 2;
-            }
-            else if (port.port_type == PORT_TYPE_MIDI_JACK && have_midi_jack_in == false)
+            if (port->getPortMode() == PORT_MODE_INPUT)
             {
-                have_midi_jack_in = true;
-                max_in_height += 2;
-            }
-            else if (port.port_type == PORT_TYPE_MIDI_A2J && have_midi_a2j_in == false)
-            {
-                have_midi_a2j_in = true;
-                max_in_height += 2;
-            }
-            else if (port.port_type == PORT_TYPE_MIDI_ALSA && have_midi_alsa_in == false)
-            {
-                have_midi_alsa_in = true;
-                max_in_height += 2;
-            }
-        }
-        else if (port.port_mode == PORT_MODE_OUTPUT)
-        {
-            max_out_height += 18;
-
-            int size = QFontMetrics(m_font_port).width(port.port_name);
-            if (size > max_out_width)
-                max_out_width = size;
+                max_in_height += 18;
+                have_in = true;
 
-            if (port.port_type == PORT_TYPE_AUDIO_JACK && have_audio_jack_out == false)
-            {
-                have_audio_jack_out = true;
-                max_out_height += 2;
-            }
-            else if (port.port_type == PORT_TYPE_MIDI_JACK && have_midi_jack_out == false)
-            {
-                have_midi_jack_out = true;
-                max_out_height += 2;
+                if (port->getPortTextWidth() > max_in_width)
+                    max_in_width = port->getPortTextWidth();
             }
-            else if (port.port_type == PORT_TYPE_MIDI_A2J && have_midi_a2j_out == false)
+            else if (port->getPortMode() == PORT_MODE_OUTPUT)
             {
-                have_midi_a2j_out = true;
-                max_out_height += 2;
-            }
-            else if (port.port_type == PORT_TYPE_MIDI_ALSA && have_midi_alsa_out == false)
-            {
-                have_midi_alsa_out = true;
-                max_out_height += 2;
+                max_out_height += 18;
+                have_out = true;
+
+                if (port->getPortTextWidth() > max_out_width)
+                    max_out_width = port->getPortTextWidth();
             }
         }
+
+        // 2px gap after each type
+        if (have_in && i != PORT_TYPE_NULL)
+            max_in_height += 2;
+        if (have_out && i != PORT_TYPE_NULL)
+            max_out_height += 2;
     }
 
     int final_width = 30 + max_in_width + max_out_width;
@@ -355,120 +347,47 @@ void CanvasBox::updatePositions()
     PortType last_in_type  = PORT_TYPE_NULL;
     PortType last_out_type = PORT_TYPE_NULL;
 
-    // Re-position ports, AUDIO_JACK
-    foreach (const port_dict_t& port, port_list)
+    // Re-position ports, AUDIO_JACK, MIDI_JACK, MIDI_A2J and then MIDI_ALSA; only ports whose slot changed are moved
+    for (int i=PORT_TYPE_AUDIO_JACK; i <= PORT_TYPE_MIDI_ALSA; i++)
     {
-        if (port.port_type == PORT_TYPE_AUDIO_JACK)
-        {
-            if (port.port_mode == PORT_MODE_INPUT)
-            {
-                port.widget->setPos(QPointF(1, last_in_pos));
-                port.widget->setPortWidth(max_in_width);
-
-                last_in_pos += 18;
-                last_in_type = port.port_type;
-            }
-            else if (port.port_mode == PORT_MODE_OUTPUT)
-            {
-                port.widget->setPos(QPointF(p_width-max_out_width-13, last_out_pos));
-                port.widget->setPortWidth(max_out_width);
-
-                last_out_pos += 18;
-                last_out_type = port.port_type;
-            }
-        }
-    }
+        const PortType port_type = static_cast<PortType>(i);
 
-    // Re-position ports, MIDI_JACK
-    foreach (const port_dict_t& port, port_list)
-    {
-        if (port.port_type == PORT_TYPE_MIDI_JACK)
+        foreach (CanvasPort* port, m_port_widgets[i])
         {
-            if (port.port_mode == PORT_MODE_INPUT)
-            {
-                if (last_in_type != PORT_TYPE_NULL && port.port_type != last_in_type)
-                    last_in_pos += 2;
-
-                port.widget->setPos(QPointF(1, last_in_pos));
-                port.widget->setPortWidth(max_in_width);
-
-                last_in_pos += 18;
-                last_in_type = port.port_type;
-            }
-            else if (port.port_mode == PORT_MODE_OUTPUT)
-            {
-                if (last_out_type != PORT_TYPE_NULL && port.port_type != last_out_type)
-                    last_out_pos += 2;
-
-                port.widget->setPos(QPointF(p_width-max_out_width-13, last_out_pos));
-                port.widget->setPortWidth(max_out_width);
+            QPointF port_pos;
 
-                last_out_pos += 18;
-                last_out_type = port.port_type;
-            }
-        }
-    }
-
-    // Re-position ports, MIDI_A2J
-    foreach (const port_dict_t& port, port_list)
-    {
-        if (port.port_type == PORT_TYPE_MIDI_A2J)
-        {
-            if (port.port_mode == PORT_MODE_INPUT)
+            if (port->getPortMode() == PORT_MODE_INPUT)
             {
-                if (last_in_type != PORT_TYPE_NULL && port.port_type != last_in_type)
+                if (last_in_type != PORT_TYPE_NULL && port_type != last_in_type)
                     last_in_pos += 2;
 
-                port.widget->setPos(QPointF(1, last_in_pos));
-                port.widget->setPortWidth(max_in_width);
+                port_pos = QPointF(1, last_in_pos);
+                port->setPortWidth(max_in_width);
 
                 last_in_pos += 18;
-                last_in_type = port.port_type;
+                last_in_type = port_type;
             }
-            else if (port.port_mode == PORT_MODE_OUTPUT)
+            else if (port->getPortMode() == PORT_MODE_OUTPUT)
             {
-                if (last_out_type != PORT_TYPE_NULL && port.port_type != last_out_type)
+                if (last_out_type != PORT_TYPE_NULL && port_type != last_out_type)
                     last_out_pos += 2;
 
-                port.widget->setPos(QPointF(p_width-max_out_width-13, last_out_pos));
-                port.widget->setPortWidth(max_out_width);
+                port_pos = QPointF(p_width-max_out_width-13, last_out_pos);
+                port->setPortWidth(max_out_width);
 
                 last_out_pos += 18;
-                last_out_type = port.port_type;
-            }
-        }
-    }
-
-    // Re-position ports, MIDI_ALSA
-    foreach (const port_dict_t& port, port_list)
-    {
-        if (port.port_type == PORT_TYPE_MIDI_ALSA)
-        {
-            if (port.port_mode == PORT_MODE_INPUT)
-            {
-                if (last_in_type != PORT_TYPE_NULL && port.port_type != last_in_type)
-                    last_in_pos += 2;
-
-                port.widget->setPos(QPointF(1, last_in_pos));
-                port.widget->setPortWidth(max_in_width);
-
-                last_in_pos += 18;
-                last_in_type = port.port_type;
+                last_out_type = port_type;
             }
-            else if (port.port_mode == PORT_MODE_OUTPUT)
-            {
-                if (last_out_type != PORT_TYPE_NULL && port.port_type != last_out_type)
-                    last_out_pos += 2;
-
-                port.widget->setPos(QPointF(p_width-max_out_width-13, last_out_pos));
-                port.widget->setPortWidth(max_out_width);
+            else
+                continue;
 
-                last_out_pos += 18;
-                last_out_type = port.port_type;
-            }
+            if (port->pos() != port_pos)
+                port->setPos(port_pos);
         }
     }
 
+    CanvasUpdateBoxRect(this);
+
     repaintLines(true);
     update();
 }
@@ -488,6 +407,9 @@ void CanvasBox::resetLinesZValue()
 {
     foreach (const connection_dict_t& connection, canvas.connection_list)
     {
+        if (! connection.widget)
+            continue;
+
         int z_value;
         if (m_port_list_ids.contains(connection.port_out_id) && m_port_list_ids.contains(connection.port_in_id))
             z_value = canvas.last_z_value;
@@ -559,13 +481,13 @@ void CanvasBox::contextMenuEvent(QGraphicsSceneContextMenuEvent* event)
 
     bool haveIns, haveOuts;
     haveIns = haveOuts = false;
-    foreach (const port_dict_t& port, canvas.port_list)
+    for (int i=0; i <= PORT_TYPE_MIDI_ALSA; i++)
     {
-        if (m_port_list_ids.contains(port.port_id))
+        foreach (CanvasPort* port, m_port_widgets[i])
         {
-            if (port.port_mode == PORT_MODE_INPUT)
+            if (port->getPortMode() == PORT_MODE_INPUT)
                 haveIns = true;
-            else if (port.port_mode == PORT_MODE_OUTPUT)
+            else if (port->getPortMode() == PORT_MODE_OUTPUT)
                 haveOuts = true;
         }
     }
@@ -662,6 +584,15 @@ void CanvasBox::mouseReleaseEvent(QGraphicsSceneMouseEvent* event)
     QGraphicsItem::mouseReleaseEvent(event);
 }
 
+QVariant CanvasBox::itemChange(GraphicsItemChange change, const QVariant& value)
+{
+    // covers setPos() and dragging alike
+    if (change == QGraphicsItem::ItemPositionHasChanged && canvas.box_rects.contains(this))
+        CanvasUpdateBoxRect(this);
+
+    return QGraphicsItem::itemChange(change, value);
+}
+
 QRectF CanvasBox::boundingRect() const
 {
     return QRectF(0, 0, p_width, p_height);
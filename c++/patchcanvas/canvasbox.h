@@ -49,6 +49,7 @@ public:
 
     int getPortCount();
     QList<int> getPortList();
+    CanvasPort* getPortAt(const QPointF& scene_pos);
 
     void setIcon(Icon icon);
     void setSplit(bool split, PortMode mode=PORT_MODE_NULL);
@@ -69,15 +70,18 @@ public:
     void resetLinesZValue();
 
     virtual int type() const;
+    virtual QRectF boundingRect() const;
 
 private:
     int m_group_id;
     QString m_group_name;
+    int m_group_name_width;
 
     int p_width;
     int p_height;
 
     QList<int> m_port_list_ids;
+    QList<CanvasPort*> m_port_widgets[PORT_TYPE_MIDI_ALSA+1]; // by port type, in the order they were added
     QList<cb_line_t> m_connection_lines;
 
     QPointF m_last_pos;
@@ -98,8 +102,8 @@ private:
     virtual void mousePressEvent(QGraphicsSceneMouseEvent* event);
     virtual void mouseMoveEvent(QGraphicsSceneMouseEvent* event);
     virtual void mouseReleaseEvent(QGraphicsSceneMouseEvent* event);
+    virtual QVariant itemChange(GraphicsItemChange change, const QVariant& value);
 
-    virtual QRectF boundingRect() const;
     virtual void paint(QPainter* painter, const QStyleOptionGraphicsItem* option, QWidget* widget);
 };
 
@@ -18,7 +18,7 @@
 #ifndef CANVASBOXSHADOW_H
 #define CANVASBOXSHADOW_H
 
-#include <QGraphicsDropShadowEffect>
+#include <QtWidgets/QGraphicsDropShadowEffect>
 
 #include "patchcanvas.h"
 
@@ -18,7 +18,7 @@
 #include "canvasicon.h"
 
 #include <QtGui/QPainter>
-#include <QtGui/QGraphicsColorizeEffect>
+#include <QtWidgets/QGraphicsColorizeEffect>
 #include <QtSvg/QSvgRenderer>
 
 START_NAMESPACE_PATCHCANVAS
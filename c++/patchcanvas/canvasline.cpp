@@ -25,8 +25,11 @@
 START_NAMESPACE_PATCHCANVAS
 
 CanvasLine::CanvasLine(CanvasPort* item1_, CanvasPort* item2_, QGraphicsItem* parent) :
-    QGraphicsLineItem(parent, canvas.scene)
+    QGraphicsLineItem(parent)
 {
+    if (! parent)
+        canvas.scene->addItem(this);
+
     item1 = item1_;
     item2 = item2_;
 
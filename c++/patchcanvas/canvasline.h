@@ -18,7 +18,7 @@
 #ifndef CANVASLINE_H
 #define CANVASLINE_H
 
-#include <QtGui/QGraphicsLineItem>
+#include <QtWidgets/QGraphicsLineItem>
 
 #include "abstractcanvasline.h"
 
@@ -24,8 +24,11 @@
 START_NAMESPACE_PATCHCANVAS
 
 CanvasLineMov::CanvasLineMov(PortMode port_mode, PortType port_type, QGraphicsItem* parent) :
-    QGraphicsLineItem(parent, canvas.scene)
+    QGraphicsLineItem(parent)
 {
+    if (! parent)
+        canvas.scene->addItem(this);
+
     m_port_mode = port_mode;
     m_port_type = port_type;
 
@@ -18,7 +18,7 @@
 #ifndef CANVASLINEMOV_H
 #define CANVASLINEMOV_H
 
-#include <QGraphicsLineItem>
+#include <QtWidgets/QGraphicsLineItem>
 
 #include "abstractcanvasline.h"
 
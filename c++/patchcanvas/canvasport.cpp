@@ -19,10 +19,10 @@
 
 #include <QtCore/QTimer>
 #include <QtGui/QCursor>
-#include <QtGui/QGraphicsSceneContextMenuEvent>
-#include <QtGui/QGraphicsSceneMouseEvent>
-#include <QtGui/QInputDialog>
-#include <QtGui/QMenu>
+#include <QtWidgets/QGraphicsSceneContextMenuEvent>
+#include <QtWidgets/QGraphicsSceneMouseEvent>
+#include <QtWidgets/QInputDialog>
+#include <QtWidgets/QMenu>
 #include <QtGui/QPainter>
 
 #include "canvaslinemov.h"
@@ -32,8 +32,11 @@
 START_NAMESPACE_PATCHCANVAS
 
 CanvasPort::CanvasPort(int port_id, QString port_name, PortMode port_mode, PortType port_type, QGraphicsItem* parent) :
-        QGraphicsItem(parent, canvas.scene)
+        QGraphicsItem(parent)
 {
+    if (! parent)
+        canvas.scene->addItem(this);
+
     // Save Variables, useful for later
     m_port_id   = port_id;
     m_port_mode = port_mode;
@@ -44,6 +47,7 @@ CanvasPort::CanvasPort(int port_id, QString port_name, PortMode port_mode, PortT
     m_port_width  = 15;
     m_port_height = 15;
     m_port_font   = QFont(canvas.theme->port_font_name, canvas.theme->port_font_size, canvas.theme->port_font_state);
+    m_port_text_width = CanvasGetTextWidth(CanvasPortFont, m_port_name);
 
     m_line_mov   = 0;
     m_hover_item = 0;
@@ -80,6 +84,11 @@ QString CanvasPort::getFullPortName()
     return ((CanvasBox*)parentItem())->getGroupName()+":"+m_port_name;
 }
 
+int CanvasPort::getPortTextWidth()
+{
+    return m_port_text_width;
+}
+
 int CanvasPort::getPortWidth()
 {
     return m_port_width;
@@ -104,15 +113,21 @@ void CanvasPort::setPortType(PortType port_type)
 
 void CanvasPort::setPortName(QString port_name)
 {
-    if (QFontMetrics(m_port_font).width(port_name) < QFontMetrics(m_port_font).width(m_port_name))
+    int text_width = CanvasGetTextWidth(CanvasPortFont, port_name);
+
+    if (text_width < m_port_text_width)
         QTimer::singleShot(0, canvas.scene, SLOT(update()));
 
     m_port_name = port_name;
+    m_port_text_width = text_width;
     update();
 }
 
 void CanvasPort::setPortWidth(int port_width)
 {
+    if (port_width == m_port_width)
+        return;
+
     if (port_width < m_port_width)
         QTimer::singleShot(0, canvas.scene, SLOT(update()));
 
@@ -142,10 +157,11 @@ void CanvasPort::mouseMoveEvent(QGraphicsSceneMouseEvent* event)
             setCursor(QCursor(Qt::CrossCursor));
             m_cursor_moving = true;
 
-            foreach (const connection_dict_t& connection, canvas.connection_list)
+            foreach (const int& connection_id, canvas.port_connections.value(m_port_id))
             {
-                if (connection.port_out_id == m_port_id || connection.port_in_id == m_port_id)
-                    connection.widget->setLocked(true);
+                AbstractCanvasLine* line = CanvasGetConnectionLine(connection_id);
+                if (line)
+                    line->setLocked(true);
             }
         }
 
@@ -162,19 +178,21 @@ void CanvasPort::mouseMoveEvent(QGraphicsSceneMouseEvent* event)
             parentItem()->setZValue(canvas.last_z_value);
         }
 
+        // only boxes under the cursor are asked, through the canvas box index
         CanvasPort* item = 0;
-        QList<QGraphicsItem*> items = canvas.scene->items(event->scenePos(), Qt::ContainsItemShape, Qt::AscendingOrder);
-        for (int i=0; i < items.count(); i++)
+        foreach (CanvasBox* box, CanvasGetBoxesAt(event->scenePos()))
         {
-            if (items[i]->type() == CanvasPortType)
+            if (! box->isVisible())
+                continue;
+
+            CanvasPort* port = box->getPortAt(event->scenePos());
+
+            if (port && port != this)
             {
-                if (items[i] != this)
-                {
-                    if (! item)
-                        item = (CanvasPort*)items[i];
-                    else if (items[i]->parentItem()->zValue() > item->parentItem()->zValue())
-                        item = (CanvasPort*)items[i];
-                }
+                if (! item)
+                    item = port;
+                else if (box->zValue() > item->parentItem()->zValue())
+                    item = port;
             }
         }
 
@@ -212,10 +230,11 @@ void CanvasPort::mouseReleaseEvent(QGraphicsSceneMouseEvent* event)
             m_line_mov = 0;
         }
 
-        foreach (const connection_dict_t& connection, canvas.connection_list)
+        foreach (const int& connection_id, canvas.port_connections.value(m_port_id))
         {
-            if (connection.port_out_id == m_port_id || connection.port_in_id == m_port_id)
-                connection.widget->setLocked(false);
+            AbstractCanvasLine* line = CanvasGetConnectionLine(connection_id);
+            if (line)
+                line->setLocked(false);
         }
 
         if (m_hover_item)
@@ -434,10 +453,11 @@ void CanvasPort::paint(QPainter* painter, const QStyleOptionGraphicsItem* /*opti
 
     if (isSelected() != m_last_selected_state)
     {
-        foreach (const connection_dict_t& connection, canvas.connection_list)
+        foreach (const int& connection_id, canvas.port_connections.value(m_port_id))
         {
-            if (connection.port_out_id == m_port_id || connection.port_in_id == m_port_id)
-                connection.widget->setLineSelected(isSelected());
+            AbstractCanvasLine* line = CanvasGetConnectionLine(connection_id);
+            if (line)
+                line->setLineSelected(isSelected());
         }
     }
 
@@ -38,6 +38,7 @@ public:
     PortType getPortType();
     QString getPortName();
     QString getFullPortName();
+    int getPortTextWidth();
     int getPortWidth();
     int getPortHeight();
 
@@ -53,6 +54,7 @@ private:
     PortMode m_port_mode;
     PortType m_port_type;
     QString m_port_name;
+    int m_port_text_width;
 
     int m_port_width;
     int m_port_height;
@@ -18,7 +18,7 @@
 #ifndef CANVASPORTGLOW_H
 #define CANVASPORTGLOW_H
 
-#include <QGraphicsDropShadowEffect>
+#include <QtWidgets/QGraphicsDropShadowEffect>
 
 #include "patchcanvas.h"
 
@@ -0,0 +1,232 @@
+/*
+ * Patchbay Canvas engine using QGraphicsView/Scene, bulk load benchmark
+ * Copyright (C) 2010-2026 Filipe Coelho <falktx@falktx.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * For a full copy of the GNU General Public License see the COPYING file
+ */
+
+#include "../patchcanvas.hpp"
+#include "patchcanvas.h"
+#include "patchscene.h"
+
+#include <QtCore/QElapsedTimer>
+#include <QtWidgets/QApplication>
+#include <QtWidgets/QGraphicsView>
+
+#include <cstdio>
+
+// -------------------------------
+// A studio-sized graph: 250 clients with 10 outputs and 10 inputs each (5000 ports),
+// every output connected to 8 inputs of other clients (20000 connections).
+
+static const int kGroups          = 250;
+static const int kPortsPerSide    = 10;
+static const int kConnsPerOutput  = 8;
+static const int kPortsPerGroup   = kPortsPerSide * 2;
+static const int kPorts           = kGroups * kPortsPerGroup;
+static const int kConnections     = kGroups * kPortsPerSide * kConnsPerOutput;
+
+static int port_out_id(const int group, const int port)
+{
+    return 1 + group * kPortsPerGroup + port;
+}
+
+static int port_in_id(const int group, const int port)
+{
+    return 1 + group * kPortsPerGroup + kPortsPerSide + port;
+}
+
+static int connection_id(const int group, const int port, const int conn)
+{
+    return 1 + (group * kPortsPerSide + port) * kConnsPerOutput + conn;
+}
+
+static void canvas_callback(PatchCanvas::CallbackAction, int, int, QString)
+{
+}
+
+// -------------------------------
+
+static QElapsedTimer gTimer;
+
+static void start()
+{
+    gTimer.start();
+}
+
+static void report(const char* const what, const int count)
+{
+    const double ms = double(gTimer.nsecsElapsed()) / 1e6;
+
+    std::printf("%-28s %6i items %10.2f ms %10.2f us/item\n", what, count, ms, ms * 1000.0 / count);
+}
+
+// -------------------------------
+
+static int count_lines()
+{
+    int lines = 0;
+
+    foreach (const PatchCanvas::connection_dict_t& connection, PatchCanvas::canvas.connection_list)
+    {
+        if (connection.widget)
+            lines += 1;
+    }
+
+    return lines;
+}
+
+// -------------------------------
+
+static void load()
+{
+    PatchCanvas::beginUpdate();
+
+    for (int g=0; g < kGroups; ++g)
+    {
+        PatchCanvas::addGroup(g, QString("client-%1").arg(g), PatchCanvas::SPLIT_YES);
+
+        for (int p=0; p < kPortsPerSide; ++p)
+        {
+            PatchCanvas::addPort(g, port_out_id(g, p), QString("out_%1").arg(p), PatchCanvas::PORT_MODE_OUTPUT, PatchCanvas::PORT_TYPE_AUDIO_JACK);
+            PatchCanvas::addPort(g, port_in_id(g, p), QString("in_%1").arg(p), PatchCanvas::PORT_MODE_INPUT, PatchCanvas::PORT_TYPE_AUDIO_JACK);
+        }
+    }
+
+    for (int g=0; g < kGroups; ++g)
+    {
+        for (int p=0; p < kPortsPerSide; ++p)
+        {
+            for (int c=0; c < kConnsPerOutput; ++c)
+            {
+                const int target = (g + 1 + c) % kGroups;
+                PatchCanvas::connectPorts(connection_id(g, p, c), port_out_id(g, p), port_in_id(target, (p + c) % kPortsPerSide));
+            }
+        }
+    }
+
+    PatchCanvas::endUpdate();
+}
+
+int main(int argc, char* argv[])
+{
+    QApplication app(argc, argv);
+    QGraphicsView view;
+    PatchScene scene(&app, &view);
+
+    PatchCanvas::options_t options;
+    options.theme_name       = PatchCanvas::getDefaultThemeName();
+    options.auto_hide_groups = false;
+    options.use_bezier_lines = true;
+    options.antialiasing     = PatchCanvas::ANTIALIASING_SMALL;
+    options.eyecandy         = PatchCanvas::EYECANDY_NONE;
+
+    PatchCanvas::features_t features;
+    features.group_info       = false;
+    features.group_rename     = false;
+    features.port_info        = false;
+    features.port_rename      = false;
+    features.handle_group_pos = false;
+
+    PatchCanvas::setOptions(&options);
+    PatchCanvas::setFeatures(&features);
+    PatchCanvas::init(&scene, canvas_callback);
+
+    view.setScene(&scene);
+
+    std::printf("patchcanvas: %i groups, %i ports, %i connections\n", kGroups, kPorts, kConnections);
+
+    start();
+    load();
+    report("load (batched)", kPorts + kConnections);
+
+    // every group goes through a relayout of all its ports and lines
+    start();
+    for (int g=0; g < kGroups; ++g)
+        PatchCanvas::joinGroup(g);
+    report("join groups", kGroups);
+
+    start();
+    for (int g=0; g < kGroups; ++g)
+        PatchCanvas::splitGroup(g);
+    report("split groups", kGroups);
+
+    // JACK disconnects a port before removing it, so drop everything touching
+    // the even groups first; removal from the middle of the lists, oldest first
+    int disconnected = 0;
+    start();
+    for (int g=0; g < kGroups; ++g)
+    {
+        for (int p=0; p < kPortsPerSide; ++p)
+        {
+            for (int c=0; c < kConnsPerOutput; ++c)
+            {
+                if (g % 2 == 0 || (g + 1 + c) % kGroups % 2 == 0)
+                {
+                    PatchCanvas::disconnectPorts(connection_id(g, p, c));
+                    ++disconnected;
+                }
+            }
+        }
+    }
+    report("disconnect even groups", disconnected);
+
+    start();
+    for (int g=0; g < kGroups; g += 2)
+    {
+        for (int p=0; p < kPortsPerSide; ++p)
+        {
+            PatchCanvas::removePort(port_out_id(g, p));
+            PatchCanvas::removePort(port_in_id(g, p));
+        }
+    }
+    report("remove ports, half groups", kPorts / 2);
+
+    start();
+    for (int g=0; g < kGroups; g += 2)
+        PatchCanvas::removeGroup(g);
+    report("remove empty groups", kGroups / 2);
+
+    start();
+    PatchCanvas::clear();
+    report("clear", kPorts / 2 + kConnections - disconnected);
+
+    // a full reload after clear(), as done on JACK server restart
+    PatchCanvas::init(&scene, canvas_callback);
+
+    start();
+    load();
+    report("reload (batched)", kPorts + kConnections);
+
+    // clients that reload everything in one batch, clear() must leave the batch open
+    start();
+    PatchCanvas::beginUpdate();
+    PatchCanvas::clear();
+    PatchCanvas::init(&scene, canvas_callback);
+    load();
+    const int lines_in_batch = count_lines();
+    PatchCanvas::endUpdate();
+    report("clear + reload, one batch", kPorts + kConnections);
+
+    // lines wait for the outermost endUpdate(), which then leaves nothing deferred
+    if (lines_in_batch != 0 || count_lines() != kConnections || PatchCanvas::canvas.update_depth != 0)
+    {
+        std::printf("FAIL: %i lines before endUpdate(), %i after, update depth %i\n",
+                    lines_in_batch, count_lines(), PatchCanvas::canvas.update_depth);
+        return 1;
+    }
+
+    PatchCanvas::clear();
+
+    return 0;
+}
@@ -22,7 +22,7 @@
 #include <QtGui/QFont>
 #include <QtGui/QPen>
 
-#include "../patchcanvas.h"
+#include "../patchcanvas.hpp"
 
 START_NAMESPACE_PATCHCANVAS
 
@@ -19,9 +19,12 @@
 #include "patchscene.h"
 
 #include <QtCore/QSettings>
+#include <QtCore/qmath.h>
 #include <QtCore/QTimer>
-#include <QtGui/QAction>
+#include <QtWidgets/QAction>
+#include <QtGui/QFontMetrics>
 
+#include "canvasarrange.h"
 #include "canvasfadeanimation.h"
 #include "canvasline.h"
 #include "canvasbezierline.h"
@@ -64,6 +67,11 @@ void CanvasObject::CanvasPostponedGroups()
     PatchCanvas::CanvasPostponedGroups();
 }
 
+void CanvasObject::ArrangeFinished()
+{
+    PatchCanvas::CanvasArrangeFinished();
+}
+
 void CanvasObject::PortContextMenuDisconnect()
 {
     bool ok;
@@ -81,16 +89,35 @@ Canvas::Canvas()
     settings  = 0;
     theme     = 0;
     initiated = false;
+    update_depth = 0;
+    arrange_thread = 0;
+
+    for (int i=0; i < CanvasFontCount; i++)
+    {
+        text_widths[i].setMaxCost(4096);
+        text_metrics[i] = 0;
+    }
 }
 
 Canvas::~Canvas()
 {
+    if (arrange_thread)
+    {
+        arrange_thread->wait();
+        delete arrange_thread;
+    }
     if (qobject)
         delete qobject;
     if (settings)
         delete settings;
     if (theme)
         delete theme;
+
+    for (int i=0; i < CanvasFontCount; i++)
+    {
+        if (text_metrics[i])
+            delete text_metrics[i];
+    }
 }
 
 /* Global objects */
@@ -150,9 +177,9 @@ const char* icon2str(Icon icon)
 {
     if (icon == ICON_HARDWARE)
         return "ICON_HARDWARE";
-    else if (ICON_APPLICATION)
+    else if (icon == ICON_APPLICATION)
         return "ICON_APPLICATION";
-    else if (ICON_LADISH_ROOM)
+    else if (icon == ICON_LADISH_ROOM)
         return "ICON_LADISH_ROOM";
     else
         return "ICON_???";
@@ -170,6 +197,125 @@ const char* split2str(SplitOption split)
         return "SPLIT_???";
 }
 
+// Removal moves the last item into the freed slot, so only one index changes and it stays O(1).
+// The lists are in no particular order after that, boxes keep their own port order
+// and group_ports keeps the order ports were added in.
+static void CanvasTakeGroup(int index)
+{
+    canvas.group_index.remove(canvas.group_list[index].group_id);
+    canvas.group_ports.remove(canvas.group_list[index].group_id);
+
+    const int last = canvas.group_list.count()-1;
+    if (index != last)
+    {
+        canvas.group_list[index] = canvas.group_list[last];
+        canvas.group_index[canvas.group_list[index].group_id] = index;
+    }
+
+    canvas.group_list.removeLast();
+}
+
+static void CanvasTakePort(int index)
+{
+    const port_dict_t& port = canvas.port_list[index];
+
+    QHash<int, QList<int> >::iterator it = canvas.group_ports.find(port.group_id);
+    if (it != canvas.group_ports.end())
+        it->removeOne(port.port_id);
+
+    canvas.port_index.remove(port.port_id);
+
+    const int last = canvas.port_list.count()-1;
+    if (index != last)
+    {
+        canvas.port_list[index] = canvas.port_list[last];
+        canvas.port_index[canvas.port_list[index].port_id] = index;
+    }
+
+    canvas.port_list.removeLast();
+}
+
+static void CanvasTakeConnection(int index)
+{
+    const connection_dict_t& connection = canvas.connection_list[index];
+    const int port_ids[2] = { connection.port_out_id, connection.port_in_id };
+
+    for (int j=0; j < 2; j++)
+    {
+        QHash<int, QList<int> >::iterator it = canvas.port_connections.find(port_ids[j]);
+        if (it == canvas.port_connections.end())
+            continue;
+
+        it->removeOne(connection.connection_id);
+
+        if (it->isEmpty())
+            canvas.port_connections.erase(it);
+    }
+
+    canvas.connection_index.remove(connection.connection_id);
+
+    const int last = canvas.connection_list.count()-1;
+    if (index != last)
+    {
+        canvas.connection_list[index] = canvas.connection_list[last];
+        canvas.connection_index[canvas.connection_list[index].connection_id] = index;
+    }
+
+    canvas.connection_list.removeLast();
+}
+
+// inside beginUpdate()/endUpdate() these only mark work for endUpdate() to do once
+static void CanvasUpdateScene()
+{
+    if (canvas.update_depth == 0)
+        QTimer::singleShot(0, canvas.scene, SLOT(update()));
+}
+
+void CanvasUpdateBox(CanvasBox* box)
+{
+    if (canvas.update_depth > 0)
+        canvas.pending_boxes.insert(box);
+    else
+        box->updatePositions();
+}
+
+static bool CanvasCreateLine(connection_dict_t& connection, bool animate)
+{
+    const int port_out_idx = CanvasGetPortIndex(connection.port_out_id);
+    const int port_in_idx  = CanvasGetPortIndex(connection.port_in_id);
+
+    if (port_out_idx < 0 || port_in_idx < 0)
+        return false;
+
+    CanvasPort* port_out = canvas.port_list[port_out_idx].widget;
+    CanvasPort* port_in  = canvas.port_list[port_in_idx].widget;
+    CanvasBox* port_out_parent = (CanvasBox*)port_out->parentItem();
+    CanvasBox* port_in_parent  = (CanvasBox*)port_in->parentItem();
+
+    if (options.use_bezier_lines)
+        connection.widget = new CanvasBezierLine(port_out, port_in, 0);
+    else
+        connection.widget = new CanvasLine(port_out, port_in, 0);
+
+    port_out_parent->addLineFromGroup(connection.widget, connection.connection_id);
+    port_in_parent->addLineFromGroup(connection.widget, connection.connection_id);
+
+    canvas.last_z_value += 1;
+    port_out_parent->setZValue(canvas.last_z_value);
+    port_in_parent->setZValue(canvas.last_z_value);
+
+    canvas.last_z_value += 1;
+    connection.widget->setZValue(canvas.last_z_value);
+
+    if (animate && options.eyecandy == EYECANDY_FULL)
+    {
+        QGraphicsItem* item = (options.use_bezier_lines) ? (QGraphicsItem*)(CanvasBezierLine*)connection.widget : (QGraphicsItem*)(CanvasLine*)connection.widget;
+        CanvasItemFX(item, true);
+    }
+
+    return true;
+}
+
 /* PatchCanvas API */
 void setOptions(options_t* new_options)
 {
@@ -239,6 +385,8 @@ void init(PatchScene* scene, Callback callback, bool debug)
     if (!canvas.theme)
         canvas.theme = new Theme(getDefaultTheme());
 
+    CanvasResetTextWidths();
+
     canvas.scene->updateTheme();
 
     canvas.initiated = true;
@@ -274,9 +422,26 @@ void clear()
     canvas.last_z_value = 0;
     canvas.last_connection_id = 0;
 
+    // a running arrange is left to finish, it has nothing to move anymore
+    if (canvas.arrange_thread)
+        canvas.arrange_thread->wait();
+
+    canvas.arrange_boxes.clear();
+
     canvas.group_list.clear();
     canvas.port_list.clear();
     canvas.connection_list.clear();
+    canvas.group_index.clear();
+    canvas.port_index.clear();
+    canvas.connection_index.clear();
+    canvas.group_ports.clear();
+    canvas.port_connections.clear();
+    // what an open beginUpdate() batch had pending is gone with the items, the batch itself
+    // stays open so clear(), init() and a reload can all go in before its endUpdate()
+    canvas.pending_boxes.clear();
+    canvas.pending_connections.clear();
+    canvas.box_rects.clear();
+    canvas.box_grid.clear();
 
     canvas.initiated = false;
 }
@@ -306,13 +471,10 @@ void addGroup(int group_id, QString group_name, SplitOption split, Icon icon)
     if (canvas.debug)
         qDebug("PatchCanvas::addGroup(%i, %s, %s, %s)", group_id, group_name.toUtf8().constData(), split2str(split), icon2str(icon));
 
-    foreach (const group_dict_t& group, canvas.group_list)
+    if (canvas.group_index.contains(group_id))
     {
-        if (group.group_id == group_id)
-        {
-            qWarning("PatchCanvas::addGroup(%i, %s, %s, %s) - group already exists", group_id, group_name.toUtf8().constData(), split2str(split), icon2str(icon));
-            return;
-        }
+        qWarning("PatchCanvas::addGroup(%i, %s, %s, %s) - group already exists", group_id, group_name.toUtf8().constData(), split2str(split), icon2str(icon));
+        return;
     }
 
     if (split == SPLIT_UNDEF && features.handle_group_pos)
@@ -350,7 +512,7 @@ void addGroup(int group_id, QString group_name, SplitOption split, Icon icon)
         canvas.last_z_value += 1;
         group_sbox->setZValue(canvas.last_z_value);
 
-        if (options.auto_hide_groups == false && options.eyecandy == EYECANDY_FULL)
+        if (options.auto_hide_groups == false && options.eyecandy == EYECANDY_FULL && canvas.update_depth == 0)
             CanvasItemFX(group_sbox, true);
     }
     else
@@ -371,11 +533,12 @@ void addGroup(int group_id, QString group_name, SplitOption split, Icon icon)
     group_box->setZValue(canvas.last_z_value);
 
     canvas.group_list.append(group_dict);
+    canvas.group_index[group_id] = canvas.group_list.count()-1;
 
-    if (options.auto_hide_groups == false && options.eyecandy == EYECANDY_FULL)
+    if (options.auto_hide_groups == false && options.eyecandy == EYECANDY_FULL && canvas.update_depth == 0)
         CanvasItemFX(group_box, true);
 
-    QTimer::singleShot(0, canvas.scene, SLOT(update()));
+    CanvasUpdateScene();
 }
 
 void removeGroup(int group_id)
@@ -383,58 +546,66 @@ void removeGroup(int group_id)
     if (canvas.debug)
         qDebug("PatchCanvas::removeGroup(%i)", group_id);
 
-    foreach2 (const group_dict_t& group, canvas.group_list)
-        if (group.group_id == group_id)
-        {
-            CanvasBox* item = group.widgets[0];
-            QString group_name = group.group_name;
+    const int i = CanvasGetGroupIndex(group_id);
+    if (i >= 0)
+    {
+        const group_dict_t& group = canvas.group_list[i];
+        CanvasBox* item = group.widgets[0];
+        QString group_name = group.group_name;
 
-            if (group.split)
-            {
-                CanvasBox* s_item = group.widgets[1];
-                if (features.handle_group_pos)
-                {
-                    canvas.settings->setValue(QString("CanvasPositions/%1_OUTPUT").arg(group_name), item->pos());
-                    canvas.settings->setValue(QString("CanvasPositions/%1_INPUT").arg(group_name), s_item->pos());
-                    canvas.settings->setValue(QString("CanvasPositions/%1_SPLIT").arg(group_name), SPLIT_YES);
-                }
-
-                if (options.eyecandy == EYECANDY_FULL)
-                {
-                    CanvasItemFX(s_item, false, true);
-                }
-                else
-                {
-                    s_item->removeIconFromScene();
-                    canvas.scene->removeItem(s_item);
-                    delete s_item;
-                }
-            }
-            else
+        canvas.pending_boxes.remove(group.widgets[0]);
+        canvas.pending_boxes.remove(group.widgets[1]);
+
+        // fading out boxes are no longer in the way
+        CanvasRemoveBoxRect(group.widgets[0]);
+        if (group.widgets[1])
+            CanvasRemoveBoxRect(group.widgets[1]);
+
+        if (group.split)
+        {
+            CanvasBox* s_item = group.widgets[1];
+            if (features.handle_group_pos)
             {
-                if (features.handle_group_pos)
-                {
-                    canvas.settings->setValue(QString("CanvasPositions/%1").arg(group_name), item->pos());
-                    canvas.settings->setValue(QString("CanvasPositions/%1_SPLIT").arg(group_name), SPLIT_NO);
-                }
+                canvas.settings->setValue(QString("CanvasPositions/%1_OUTPUT").arg(group_name), item->pos());
+                canvas.settings->setValue(QString("CanvasPositions/%1_INPUT").arg(group_name), s_item->pos());
+                canvas.settings->setValue(QString("CanvasPositions/%1_SPLIT").arg(group_name), SPLIT_YES);
             }
 
             if (options.eyecandy == EYECANDY_FULL)
             {
-                CanvasItemFX(item, false, true);
+                CanvasItemFX(s_item, false, true);
             }
             else
             {
-                item->removeIconFromScene();
-                canvas.scene->removeItem(item);
-                delete item;
+                s_item->removeIconFromScene();
+                canvas.scene->removeItem(s_item);
+                delete s_item;
             }
+        }
+        else
+        {
+            if (features.handle_group_pos)
+            {
+                canvas.settings->setValue(QString("CanvasPositions/%1").arg(group_name), item->pos());
+                canvas.settings->setValue(QString("CanvasPositions/%1_SPLIT").arg(group_name), SPLIT_NO);
+            }
+        }
 
-            canvas.group_list.takeAt(i);
-
-            QTimer::singleShot(0, canvas.scene, SLOT(update()));
-            return;
+        if (options.eyecandy == EYECANDY_FULL)
+        {
+            CanvasItemFX(item, false, true);
         }
+        else
+        {
+            item->removeIconFromScene();
+            canvas.scene->removeItem(item);
+            delete item;
+        }
+
+        CanvasTakeGroup(i);
+
+        CanvasUpdateScene();
+        return;
     }
 
     qCritical("PatchCanvas::removeGroup(%i) - unable to find group to remove", group_id);
@@ -445,18 +616,18 @@ void renameGroup(int group_id, QString new_group_name)
     if (canvas.debug)
         qDebug("PatchCanvas::renameGroup(%i, %s)", group_id, new_group_name.toUtf8().constData());
 
-    foreach2 (group_dict_t& group, canvas.group_list)
-        if (group.group_id == group_id)
-        {
-            group.group_name = new_group_name;
-            group.widgets[0]->setGroupName(new_group_name);
+    const int i = CanvasGetGroupIndex(group_id);
+    if (i >= 0)
+    {
+        group_dict_t& group = canvas.group_list[i];
+        group.group_name = new_group_name;
+        group.widgets[0]->setGroupName(new_group_name);
 
-            if (group.split && group.widgets[1])
-                group.widgets[1]->setGroupName(new_group_name);
+        if (group.split && group.widgets[1])
+            group.widgets[1]->setGroupName(new_group_name);
 
-            QTimer::singleShot(0, canvas.scene, SLOT(update()));
-            return;
-        }
+        CanvasUpdateScene();
+        return;
     }
 
     qCritical("PatchCanvas::renameGroup(%i, %s) - unable to find group to rename", group_id, new_group_name.toUtf8().constData());
@@ -474,21 +645,19 @@ void splitGroup(int group_id)
     QList<connection_dict_t> conns_data;
 
     // Step 1 - Store all Item data
-    foreach (const group_dict_t& group, canvas.group_list)
+    const int group_idx = CanvasGetGroupIndex(group_id);
+    if (group_idx >= 0)
     {
-        if (group.group_id == group_id)
+        const group_dict_t& group = canvas.group_list[group_idx];
+        if (group.split)
         {
-            if (group.split)
-            {
-                qCritical("PatchCanvas::splitGroup(%i) - group is already splitted", group_id);
-                return;
-            }
-
-            item = group.widgets[0];
-            group_name = group.group_name;
-            group_icon = group.icon;
-            break;
+            qCritical("PatchCanvas::splitGroup(%i) - group is already splitted", group_id);
+            return;
         }
+
+        item = group.widgets[0];
+        group_name = group.group_name;
+        group_icon = group.icon;
     }
 
     if (!item)
@@ -499,10 +668,13 @@ void splitGroup(int group_id)
 
     QList<int> port_list_ids = QList<int>(item->getPortList());
 
-    foreach (const port_dict_t& port, canvas.port_list)
+    // in the order they were added, port_list has none
+    foreach (const int& port_id, canvas.group_ports.value(group_id))
     {
-        if (port_list_ids.contains(port.port_id))
+        const int port_idx = CanvasGetPortIndex(port_id);
+        if (port_idx >= 0 && port_list_ids.contains(port_id))
         {
+            const port_dict_t& port = canvas.port_list[port_idx];
             port_dict_t port_dict;
             port_dict.group_id  = port.group_id;
             port_dict.port_id   = port.port_id;
@@ -545,7 +717,7 @@ void splitGroup(int group_id)
     foreach (const connection_dict_t& conn, conns_data)
         connectPorts(conn.connection_id, conn.port_out_id, conn.port_in_id);
 
-    QTimer::singleShot(0, canvas.scene, SLOT(update()));
+    CanvasUpdateScene();
 }
 
 void joinGroup(int group_id)
@@ -561,22 +733,20 @@ void joinGroup(int group_id)
     QList<connection_dict_t> conns_data;
 
     // Step 1 - Store all Item data
-    foreach (const group_dict_t& group, canvas.group_list)
+    const int group_idx = CanvasGetGroupIndex(group_id);
+    if (group_idx >= 0)
     {
-        if (group.group_id == group_id)
+        const group_dict_t& group = canvas.group_list[group_idx];
+        if (group.split == false)
         {
-            if (group.split == false)
-            {
-                qCritical("PatchCanvas::joinGroup(%i) - group is not splitted", group_id);
-                return;
-            }
-
-            item   = group.widgets[0];
-            s_item = group.widgets[1];
-            group_name = group.group_name;
-            group_icon = group.icon;
-            break;
+            qCritical("PatchCanvas::joinGroup(%i) - group is not splitted", group_id);
+            return;
         }
+
+        item   = group.widgets[0];
+        s_item = group.widgets[1];
+        group_name = group.group_name;
+        group_icon = group.icon;
     }
 
     if (!item || !s_item)
@@ -594,10 +764,13 @@ void joinGroup(int group_id)
             port_list_ids.append(port_id);
     }
 
-    foreach (const port_dict_t& port, canvas.port_list)
+    // in the order they were added, port_list has none
+    foreach (const int& port_id, canvas.group_ports.value(group_id))
     {
-        if (port_list_ids.contains(port.port_id))
+        const int port_idx = CanvasGetPortIndex(port_id);
+        if (port_idx >= 0 && port_list_ids.contains(port_id))
         {
+            const port_dict_t& port = canvas.port_list[port_idx];
             port_dict_t port_dict;
             port_dict.group_id  = port.group_id;
             port_dict.port_id   = port.port_id;
@@ -640,7 +813,7 @@ void joinGroup(int group_id)
     foreach (const connection_dict_t& conn, conns_data)
         connectPorts(conn.connection_id, conn.port_out_id, conn.port_in_id);
 
-    QTimer::singleShot(0, canvas.scene, SLOT(update()));
+    CanvasUpdateScene();
 }
 
 QPointF getGroupPos(int group_id, PortMode port_mode)
@@ -648,22 +821,21 @@ QPointF getGroupPos(int group_id, PortMode port_mode)
     if (canvas.debug)
         qDebug("PatchCanvas::getGroupPos(%i, %s)", group_id, port_mode2str(port_mode));
 
-    foreach (const group_dict_t& group, canvas.group_list)
+    const int i = CanvasGetGroupIndex(group_id);
+    if (i >= 0)
     {
-        if (group.group_id == group_id)
+        const group_dict_t& group = canvas.group_list[i];
+        if (group.split)
         {
-            if (group.split)
-            {
-                if (port_mode == PORT_MODE_OUTPUT)
-                    return group.widgets[0]->pos();
-                else if (port_mode == PORT_MODE_INPUT)
-                    return group.widgets[1]->pos();
-                else
-                    return QPointF(0, 0);
-            }
-            else
+            if (port_mode == PORT_MODE_OUTPUT)
                 return group.widgets[0]->pos();
+            else if (port_mode == PORT_MODE_INPUT)
+                return group.widgets[1]->pos();
+            else
+                return QPointF(0, 0);
         }
+        else
+            return group.widgets[0]->pos();
     }
 
     qCritical("PatchCanvas::getGroupPos(%i, %s) - unable to find group", group_id, port_mode2str(port_mode));
@@ -680,20 +852,19 @@ void setGroupPos(int group_id, int group_pos_x, int group_pos_y, int group_pos_x
     if (canvas.debug)
         qDebug("PatchCanvas::setGroupPos(%i, %i, %i, %i, %i)", group_id, group_pos_x, group_pos_y, group_pos_xs, group_pos_ys);
 
-    foreach (const group_dict_t& group, canvas.group_list)
+    const int i = CanvasGetGroupIndex(group_id);
+    if (i >= 0)
     {
-        if (group.group_id == group_id)
-        {
-            group.widgets[0]->setPos(group_pos_x, group_pos_y);
+        const group_dict_t& group = canvas.group_list[i];
+        group.widgets[0]->setPos(group_pos_x, group_pos_y);
 
-            if (group.split && group.widgets[1])
-            {
-                group.widgets[1]->setPos(group_pos_xs, group_pos_ys);
-            }
-
-            QTimer::singleShot(0, canvas.scene, SLOT(update()));
-            return;
+        if (group.split && group.widgets[1])
+        {
+            group.widgets[1]->setPos(group_pos_xs, group_pos_ys);
         }
+
+        CanvasUpdateScene();
+        return;
     }
 
     qCritical("PatchCanvas::setGroupPos(%i, %i, %i, %i, %i) - unable to find group to reposition", group_id, group_pos_x, group_pos_y, group_pos_xs, group_pos_ys);
@@ -704,18 +875,18 @@ void setGroupIcon(int group_id, Icon icon)
     if (canvas.debug)
         qDebug("PatchCanvas::setGroupIcon(%i, %s)", group_id, icon2str(icon));
 
-    foreach2 (group_dict_t& group, canvas.group_list)
-        if (group.group_id == group_id)
-        {
-            group.icon = icon;
-            group.widgets[0]->setIcon(icon);
+    const int i = CanvasGetGroupIndex(group_id);
+    if (i >= 0)
+    {
+        group_dict_t& group = canvas.group_list[i];
+        group.icon = icon;
+        group.widgets[0]->setIcon(icon);
 
-            if (group.split && group.widgets[1])
-                group.widgets[1]->setIcon(icon);
+        if (group.split && group.widgets[1])
+            group.widgets[1]->setIcon(icon);
 
-            QTimer::singleShot(0, canvas.scene, SLOT(update()));
-            return;
-        }
+        CanvasUpdateScene();
+        return;
     }
 
     qCritical("PatchCanvas::setGroupIcon(%i, %s) - unable to find group to change icon", group_id, icon2str(icon));
@@ -726,31 +897,27 @@ void addPort(int group_id, int port_id, QString port_name, PortMode port_mode, P
     if (canvas.debug)
         qDebug("PatchCanvas::addPort(%i, %i, %s, %s, %s)", group_id, port_id, port_name.toUtf8().constData(), port_mode2str(port_mode), port_type2str(port_type));
 
-    foreach (const port_dict_t& port, canvas.port_list)
+    // port ids are unique across groups, removePort() and connectPorts() only get the port_id
+    if (canvas.port_index.contains(port_id))
     {
-        if (port.group_id == group_id and port.port_id == port_id)
-        {
-            qWarning("PatchCanvas::addPort(%i, %i, %s, %s, %s) - port already exists" , group_id, port_id, port_name.toUtf8().constData(), port_mode2str(port_mode), port_type2str(port_type));
-            return;
-        }
+        qWarning("PatchCanvas::addPort(%i, %i, %s, %s, %s) - port already exists" , group_id, port_id, port_name.toUtf8().constData(), port_mode2str(port_mode), port_type2str(port_type));
+        return;
     }
 
     CanvasBox* box_widget = 0;
     CanvasPort* port_widget = 0;
 
-    foreach (const group_dict_t& group, canvas.group_list)
+    const int group_idx = CanvasGetGroupIndex(group_id);
+    if (group_idx >= 0)
     {
-        if (group.group_id == group_id)
-        {
-            int n;
-            if (group.split && group.widgets[0]->getSplittedMode() != port_mode && group.widgets[1])
-                n = 1;
-            else
-                n = 0;
-            box_widget = group.widgets[n];
-            port_widget = box_widget->addPortFromGroup(port_id, port_name, port_mode, port_type);
-            break;
-        }
+        const group_dict_t& group = canvas.group_list[group_idx];
+        int n;
+        if (group.split && group.widgets[0]->getSplittedMode() != port_mode && group.widgets[1])
+            n = 1;
+        else
+            n = 0;
+        box_widget = group.widgets[n];
+        port_widget = box_widget->addPortFromGroup(port_id, port_name, port_mode, port_type);
     }
 
     if (!box_widget || !port_widget)
@@ -759,7 +926,7 @@ void addPort(int group_id, int port_id, QString port_name, PortMode port_mode, P
         return;
     }
 
-    if (options.eyecandy == EYECANDY_FULL)
+    if (options.eyecandy == EYECANDY_FULL && canvas.update_depth == 0)
         CanvasItemFX(port_widget, true);
 
     port_dict_t port_dict;
@@ -770,10 +937,12 @@ void addPort(int group_id, int port_id, QString port_name, PortMode port_mode, P
     port_dict.port_type = port_type;
     port_dict.widget    = port_widget;
     canvas.port_list.append(port_dict);
+    canvas.port_index[port_id] = canvas.port_list.count()-1;
+    canvas.group_ports[group_id].append(port_id);
 
-    box_widget->updatePositions();
+    CanvasUpdateBox(box_widget);
 
-    QTimer::singleShot(0, canvas.scene, SLOT(update()));
+    CanvasUpdateScene();
 }
 
 void removePort(int port_id)
@@ -781,19 +950,18 @@ void removePort(int port_id)
     if (canvas.debug)
         qDebug("PatchCanvas::removePort(%i)", port_id);
 
-    foreach2 (const port_dict_t& port, canvas.port_list)
-        if (port.port_id == port_id)
-        {
-            CanvasPort* item = port.widget;
-            ((CanvasBox*)item->parentItem())->removePortFromGroup(port_id);
-            canvas.scene->removeItem(item);
-            delete item;
+    const int i = CanvasGetPortIndex(port_id);
+    if (i >= 0)
+    {
+        CanvasPort* item = canvas.port_list[i].widget;
+        ((CanvasBox*)item->parentItem())->removePortFromGroup(port_id);
+        canvas.scene->removeItem(item);
+        delete item;
 
-            canvas.port_list.takeAt(i);
+        CanvasTakePort(i);
 
-            QTimer::singleShot(0, canvas.scene, SLOT(update()));
-            return;
-        }
+        CanvasUpdateScene();
+        return;
     }
 
     qCritical("PatchCanvas::removePort(%i) - unable to find port to remove", port_id);
@@ -804,16 +972,16 @@ void renamePort(int port_id, QString new_port_name)
     if (canvas.debug)
         qDebug("PatchCanvas::renamePort(%i, %s)", port_id, new_port_name.toUtf8().constData());
 
-    foreach2 (port_dict_t& port, canvas.port_list)
-        if (port.port_id == port_id)
-        {
-            port.port_name = new_port_name;
-            port.widget->setPortName(new_port_name);
-            ((CanvasBox*)port.widget->parentItem())->updatePositions();
+    const int i = CanvasGetPortIndex(port_id);
+    if (i >= 0)
+    {
+        port_dict_t& port = canvas.port_list[i];
+        port.port_name = new_port_name;
+        port.widget->setPortName(new_port_name);
+        CanvasUpdateBox((CanvasBox*)port.widget->parentItem());
 
-            QTimer::singleShot(0, canvas.scene, SLOT(update()));
-            return;
-        }
+        CanvasUpdateScene();
+        return;
     }
 
     qCritical("PatchCanvas::renamePort(%i, %s) - unable to find port to rename", port_id, new_port_name.toUtf8().constData());
@@ -824,26 +992,16 @@ void connectPorts(int connection_id, int port_out_id, int port_in_id)
     if (canvas.debug)
         qDebug("PatchCanvas::connectPorts(%i, %i, %i)", connection_id, port_out_id, port_in_id);
 
-    CanvasPort* port_out = 0;
-    CanvasPort* port_in  = 0;
-    CanvasBox* port_out_parent = 0;
-    CanvasBox* port_in_parent  = 0;
-
-    foreach (const port_dict_t& port, canvas.port_list)
+    if (canvas.connection_index.contains(connection_id))
     {
-        if (port.port_id == port_out_id)
-        {
-            port_out = port.widget;
-            port_out_parent = (CanvasBox*)port_out->parentItem();
-        }
-        else if (port.port_id == port_in_id)
-        {
-            port_in = port.widget;
-            port_in_parent = (CanvasBox*)port_in->parentItem();
-        }
+        qWarning("PatchCanvas::connectPorts(%i, %i, %i) - connection already exists", connection_id, port_out_id, port_in_id);
+        return;
     }
 
-    if (!port_out || !port_in)
+    const int port_out_idx = CanvasGetPortIndex(port_out_id);
+    const int port_in_idx  = CanvasGetPortIndex(port_in_id);
+
+    if (port_out_idx < 0 || port_in_idx < 0 || port_out_idx == port_in_idx)
     {
         qCritical("PatchCanvas::connectPorts(%i, %i, %i) - Unable to find ports to connect", connection_id, port_out_id, port_in_id);
         return;
@@ -853,31 +1011,20 @@ void connectPorts(int connection_id, int port_out_id, int port_in_id)
     connection_dict.connection_id = connection_id;
     connection_dict.port_out_id = port_out_id;
     connection_dict.port_in_id  = port_in_id;
+    connection_dict.widget      = 0;
 
-    if (options.use_bezier_lines)
-        connection_dict.widget = new CanvasBezierLine(port_out, port_in, 0);
+    // lines are created in endUpdate(), once the boxes have their final layout
+    if (canvas.update_depth > 0)
+        canvas.pending_connections.append(connection_id);
     else
-        connection_dict.widget = new CanvasLine(port_out, port_in, 0);
-
-    port_out_parent->addLineFromGroup(connection_dict.widget, connection_id);
-    port_in_parent->addLineFromGroup(connection_dict.widget, connection_id);
-
-    canvas.last_z_value += 1;
-    port_out_parent->setZValue(canvas.last_z_value);
-    port_in_parent->setZValue(canvas.last_z_value);
-
-    canvas.last_z_value += 1;
-    connection_dict.widget->setZValue(canvas.last_z_value);
+        CanvasCreateLine(connection_dict, true);
 
     canvas.connection_list.append(connection_dict);
+    canvas.connection_index[connection_id] = canvas.connection_list.count()-1;
+    canvas.port_connections[port_out_id].append(connection_id);
+    canvas.port_connections[port_in_id].append(connection_id);
 
-    if (options.eyecandy == EYECANDY_FULL)
-    {
-        QGraphicsItem* item = (options.use_bezier_lines) ? (QGraphicsItem*)(CanvasBezierLine*)connection_dict.widget : (QGraphicsItem*)(CanvasLine*)connection_dict.widget;
-        CanvasItemFX(item, true);
-    }
-
-    QTimer::singleShot(0, canvas.scene, SLOT(update()));
+    CanvasUpdateScene();
 }
 
 void disconnectPorts(int connection_id)
@@ -890,15 +1037,22 @@ void disconnectPorts(int connection_id)
     QGraphicsItem* item1 = 0;
     QGraphicsItem* item2 = 0;
 
-    foreach2 (const connection_dict_t& connection, canvas.connection_list)
-        if (connection.connection_id == connection_id)
+    const int i = CanvasGetConnectionIndex(connection_id);
+    if (i >= 0)
+    {
+        const connection_dict_t& connection = canvas.connection_list[i];
+        port_1_id = connection.port_out_id;
+        port_2_id = connection.port_in_id;
+        line = connection.widget;
+
+        // not drawn yet, nothing else to undo; endUpdate() skips ids that are gone
+        if (! line)
         {
-            port_1_id = connection.port_out_id;
-            port_2_id = connection.port_in_id;
-            line = connection.widget;
-            canvas.connection_list.takeAt(i);
-            break;
+            CanvasTakeConnection(i);
+            return;
         }
+
+        CanvasTakeConnection(i);
     }
 
     if (!line)
@@ -907,14 +1061,9 @@ void disconnectPorts(int connection_id)
         return;
     }
 
-    foreach (const port_dict_t& port, canvas.port_list)
-    {
-        if (port.port_id == port_1_id)
-        {
-            item1 = port.widget;
-            break;
-        }
-    }
+    const int port_1_idx = CanvasGetPortIndex(port_1_id);
+    if (port_1_idx >= 0)
+        item1 = canvas.port_list[port_1_idx].widget;
 
     if (!item1)
     {
@@ -922,14 +1071,9 @@ void disconnectPorts(int connection_id)
         return;
     }
 
-    foreach (const port_dict_t& port, canvas.port_list)
-    {
-        if (port.port_id == port_2_id)
-        {
-            item2 = port.widget;
-            break;
-        }
-    }
+    const int port_2_idx = CanvasGetPortIndex(port_2_id);
+    if (port_2_idx >= 0)
+        item2 = canvas.port_list[port_2_idx].widget;
 
     if (!item2)
     {
@@ -948,6 +1092,48 @@ void disconnectPorts(int connection_id)
     else
         line->deleteFromScene();
 
+    CanvasUpdateScene();
+}
+
+void beginUpdate()
+{
+    if (canvas.debug)
+        qDebug("PatchCanvas::beginUpdate()");
+
+    canvas.update_depth += 1;
+}
+
+void endUpdate()
+{
+    if (canvas.debug)
+        qDebug("PatchCanvas::endUpdate()");
+
+    if (canvas.update_depth == 0)
+    {
+        qCritical("PatchCanvas::endUpdate() - called without beginUpdate()");
+        return;
+    }
+
+    if (--canvas.update_depth > 0)
+        return;
+
+    foreach (CanvasBox* box, canvas.pending_boxes)
+        box->updatePositions();
+
+    // ids may be gone, or queued twice if disconnected and connected again in the same batch
+    foreach (const int& connection_id, canvas.pending_connections)
+    {
+        const int i = CanvasGetConnectionIndex(connection_id);
+        if (i < 0 || canvas.connection_list[i].widget)
+            continue;
+
+        if (! CanvasCreateLine(canvas.connection_list[i], false))
+            qCritical("PatchCanvas::endUpdate() - unable to find ports of connection %i", connection_id);
+    }
+
+    canvas.pending_boxes.clear();
+    canvas.pending_connections.clear();
+
     QTimer::singleShot(0, canvas.scene, SLOT(update()));
 }
 
@@ -955,6 +1141,74 @@ void arrange()
 {
     if (canvas.debug)
         qDebug("PatchCanvas::Arrange()");
+
+    if (canvas.arrange_thread && canvas.arrange_thread->isRunning())
+    {
+        qWarning("PatchCanvas::arrange() - already arranging");
+        return;
+    }
+
+    // Step 1 - Copy the graph, split groups have one box per side
+    QHash<CanvasBox*, int> box_nodes;
+    QVector<arrange_node_t> nodes;
+    QVector<arrange_edge_t> edges;
+
+    canvas.arrange_boxes.clear();
+
+    foreach (const group_dict_t& group, canvas.group_list)
+    {
+        for (int i=0; i < 2; i++)
+        {
+            CanvasBox* box = group.widgets[i];
+            if (! box || (i == 1 && ! group.split))
+                continue;
+
+            const QRectF rect = box->boundingRect();
+
+            arrange_node_t node;
+            node.width    = rect.width();
+            node.height   = rect.height();
+            node.hardware = (group.icon == ICON_HARDWARE);
+
+            arrange_box_t arrange_box;
+            arrange_box.group_id = group.group_id;
+            arrange_box.side     = i;
+
+            box_nodes[box] = nodes.count();
+            nodes.append(node);
+            canvas.arrange_boxes.append(arrange_box);
+        }
+    }
+
+    foreach (const connection_dict_t& connection, canvas.connection_list)
+    {
+        const int port_out_idx = CanvasGetPortIndex(connection.port_out_id);
+        const int port_in_idx  = CanvasGetPortIndex(connection.port_in_id);
+
+        if (port_out_idx < 0 || port_in_idx < 0)
+            continue;
+
+        CanvasBox* box_out = (CanvasBox*)canvas.port_list[port_out_idx].widget->parentItem();
+        CanvasBox* box_in  = (CanvasBox*)canvas.port_list[port_in_idx].widget->parentItem();
+
+        if (! box_nodes.contains(box_out) || ! box_nodes.contains(box_in))
+            continue;
+
+        arrange_edge_t edge;
+        edge.node_out = box_nodes[box_out];
+        edge.node_in  = box_nodes[box_in];
+        edges.append(edge);
+    }
+
+    // Step 2 - Layout in the background, CanvasArrangeFinished() moves the boxes
+    if (! canvas.arrange_thread)
+    {
+        canvas.arrange_thread = new CanvasArrange();
+        QObject::connect(canvas.arrange_thread, SIGNAL(finished()), canvas.qobject, SLOT(ArrangeFinished()));
+    }
+
+    canvas.arrange_thread->setGraph(nodes, edges, canvas.initial_pos);
+    canvas.arrange_thread->start(QThread::LowPriority);
 }
 
 void updateZValues()
@@ -974,16 +1228,158 @@ void updateZValues()
 
 /* Extra Internal functions */
 
+int CanvasGetGroupIndex(int group_id)
+{
+    return canvas.group_index.value(group_id, -1);
+}
+
+int CanvasGetPortIndex(int port_id)
+{
+    return canvas.port_index.value(port_id, -1);
+}
+
+int CanvasGetConnectionIndex(int connection_id)
+{
+    return canvas.connection_index.value(connection_id, -1);
+}
+
+AbstractCanvasLine* CanvasGetConnectionLine(int connection_id)
+{
+    const int i = CanvasGetConnectionIndex(connection_id);
+    return (i >= 0) ? canvas.connection_list[i].widget : 0;
+}
+
+int CanvasGetTextWidth(CanvasFont font, const QString& text)
+{
+    int* width = canvas.text_widths[font].object(text);
+
+    if (width)
+        return *width;
+
+    if (!canvas.text_metrics[font])
+    {
+        if (font == CanvasBoxFont)
+            canvas.text_metrics[font] = new QFontMetrics(QFont(canvas.theme->box_font_name, canvas.theme->box_font_size, canvas.theme->box_font_state));
+        else
+            canvas.text_metrics[font] = new QFontMetrics(QFont(canvas.theme->port_font_name, canvas.theme->port_font_size, canvas.theme->port_font_state));
+    }
+
+    int new_width = canvas.text_metrics[font]->width(text);
+    canvas.text_widths[font].insert(text, new int(new_width));
+    return new_width;
+}
+
+// call when the theme or its fonts change
+void CanvasResetTextWidths()
+{
+    for (int i=0; i < CanvasFontCount; i++)
+    {
+        canvas.text_widths[i].clear();
+
+        if (canvas.text_metrics[i])
+        {
+            delete canvas.text_metrics[i];
+            canvas.text_metrics[i] = 0;
+        }
+    }
+}
+
+// box rects are kept in a grid of square cells, lookups only check the cell of the point
+static const int canvas_grid_size = 256;
+
+static qint64 CanvasGetGridKey(int x, int y)
+{
+    return (qint64(x) << 32) | quint32(y);
+}
+
+static void CanvasGridInsert(CanvasBox* box, const QRectF& rect)
+{
+    const int x1 = qFloor(rect.left()/canvas_grid_size);
+    const int y1 = qFloor(rect.top()/canvas_grid_size);
+    const int x2 = qFloor(rect.right()/canvas_grid_size);
+    const int y2 = qFloor(rect.bottom()/canvas_grid_size);
+
+    for (int x=x1; x <= x2; x++)
+    {
+        for (int y=y1; y <= y2; y++)
+            canvas.box_grid[CanvasGetGridKey(x, y)].append(box);
+    }
+}
+
+static void CanvasGridRemove(CanvasBox* box, const QRectF& rect)
+{
+    const int x1 = qFloor(rect.left()/canvas_grid_size);
+    const int y1 = qFloor(rect.top()/canvas_grid_size);
+    const int x2 = qFloor(rect.right()/canvas_grid_size);
+    const int y2 = qFloor(rect.bottom()/canvas_grid_size);
+
+    for (int x=x1; x <= x2; x++)
+    {
+        for (int y=y1; y <= y2; y++)
+        {
+            QHash<qint64, QList<CanvasBox*> >::iterator it = canvas.box_grid.find(CanvasGetGridKey(x, y));
+            if (it == canvas.box_grid.end())
+                continue;
+
+            it->removeOne(box);
+
+            if (it->isEmpty())
+                canvas.box_grid.erase(it);
+        }
+    }
+}
+
+// call after a box moves or changes size
+void CanvasUpdateBoxRect(CanvasBox* box)
+{
+    const QRectF rect = box->sceneBoundingRect();
+
+    QHash<CanvasBox*, QRectF>::iterator it = canvas.box_rects.find(box);
+    if (it != canvas.box_rects.end())
+    {
+        if (*it == rect)
+            return;
+
+        CanvasGridRemove(box, *it);
+        *it = rect;
+    }
+    else
+        canvas.box_rects.insert(box, rect);
+
+    CanvasGridInsert(box, rect);
+}
+
+void CanvasRemoveBoxRect(CanvasBox* box)
+{
+    QHash<CanvasBox*, QRectF>::iterator it = canvas.box_rects.find(box);
+    if (it == canvas.box_rects.end())
+        return;
+
+    CanvasGridRemove(box, *it);
+    canvas.box_rects.erase(it);
+}
+
+QList<CanvasBox*> CanvasGetBoxesAt(const QPointF& pos)
+{
+    QList<CanvasBox*> boxes;
+
+    foreach (CanvasBox* box, canvas.box_grid.value(CanvasGetGridKey(qFloor(pos.x()/canvas_grid_size), qFloor(pos.y()/canvas_grid_size))))
+    {
+        if (canvas.box_rects.value(box).contains(pos))
+            boxes.append(box);
+    }
+
+    return boxes;
+}
+
 QString CanvasGetGroupName(int group_id)
 {
     if (canvas.debug)
         qDebug("PatchCanvas::CanvasGetGroupName(%i)", group_id);
 
-    foreach (const group_dict_t& group, canvas.group_list)
-    {
-        if (group.group_id == group_id)
-            return group.group_name;
-    }
+    const int i = CanvasGetGroupIndex(group_id);
+    if (i >= 0)
+        return canvas.group_list[i].group_name;
 
     qCritical("PatchCanvas::CanvasGetGroupName(%i) - unable to find group", group_id);
     return "";
@@ -994,14 +1390,7 @@ int CanvasGetGroupPortCount(int group_id)
     if (canvas.debug)
         qDebug("PatchCanvas::CanvasGetGroupPortCount(%i)", group_id);
 
-    int port_count = 0;
-    foreach (const port_dict_t& port, canvas.port_list)
-    {
-        if (port.group_id == group_id)
-            port_count += 1;
-    }
-
-    return port_count;
+    return canvas.group_ports.value(group_id).count();
 }
 
 QPointF CanvasGetNewGroupPos(bool horizontal)
@@ -1010,29 +1399,21 @@ QPointF CanvasGetNewGroupPos(bool horizontal)
         qDebug("PatchCanvas::CanvasGetNewGroupPos(%s)", bool2str(horizontal));
 
     QPointF new_pos(canvas.initial_pos.x(), canvas.initial_pos.y());
-    QList<QGraphicsItem*> items = canvas.scene->items();
 
-    bool break_loop = false;
-    while (break_loop == false)
+    // step over whatever box covers the spot until a free one is found
+    for (;;)
     {
-        bool break_for = false;
-        for (int i=0; i < items.count(); i++)
-        {
-            QGraphicsItem* item = items[i];
-            if (item && item->type() == CanvasBoxType)
-            {
-                if (item->sceneBoundingRect().contains(new_pos))
-                {
-                    if (horizontal)
-                        new_pos += QPointF(item->boundingRect().width()+15, 0);
-                    else
-                        new_pos += QPointF(0, item->boundingRect().height()+15);
-                    break;
-                }
-            }
-            if (i >= items.count()-1 && break_for == false)
-                break_loop = true;
-        }
+        QList<CanvasBox*> boxes = CanvasGetBoxesAt(new_pos);
+
+        if (boxes.isEmpty())
+            break;
+
+        const QRectF rect = canvas.box_rects.value(boxes[0]);
+
+        if (horizontal)
+            new_pos += QPointF(rect.width()+15, 0);
+        else
+            new_pos += QPointF(0, rect.height()+15);
     }
 
     return new_pos;
@@ -1043,18 +1424,13 @@ QString CanvasGetFullPortName(int port_id)
     if (canvas.debug)
         qDebug("PatchCanvas::CanvasGetFullPortName(%i)", port_id);
 
-    foreach (const port_dict_t& port, canvas.port_list)
+    const int port_idx = CanvasGetPortIndex(port_id);
+    if (port_idx >= 0)
     {
-        if (port.port_id == port_id)
-        {
-            int group_id = port.group_id;
-            foreach (const group_dict_t& group, canvas.group_list)
-            {
-                if (group.group_id == group_id)
-                    return group.group_name + ":" + port.port_name;
-            }
-            break;
-        }
+        const port_dict_t& port = canvas.port_list[port_idx];
+        const int group_idx = CanvasGetGroupIndex(port.group_id);
+        if (group_idx >= 0)
+            return canvas.group_list[group_idx].group_name + ":" + port.port_name;
     }
 
     qCritical("PatchCanvas::CanvasGetFullPortName(%i) - unable to find port", port_id);
@@ -1066,15 +1442,7 @@ QList<int> CanvasGetPortConnectionList(int port_id)
     if (canvas.debug)
         qDebug("PatchCanvas::CanvasGetPortConnectionList(%i)", port_id);
 
-    QList<int> port_con_list;
-
-    foreach (const connection_dict_t& connection, canvas.connection_list)
-    {
-        if (connection.port_out_id == port_id || connection.port_in_id == port_id)
-            port_con_list.append(connection.connection_id);
-    }
-
-    return port_con_list;
+    return canvas.port_connections.value(port_id);
 }
 
 int CanvasGetConnectedPort(int connection_id, int port_id)
@@ -1082,15 +1450,14 @@ int CanvasGetConnectedPort(int connection_id, int port_id)
     if (canvas.debug)
         qDebug("PatchCanvas::CanvasGetConnectedPort(%i, %i)", connection_id, port_id);
 
-    foreach (const connection_dict_t& connection, canvas.connection_list)
+    const int i = CanvasGetConnectionIndex(connection_id);
+    if (i >= 0)
     {
-        if (connection.connection_id == connection_id)
-        {
-            if (connection.port_out_id == port_id)
-                return connection.port_in_id;
-            else
-                return connection.port_out_id;
-        }
+        const connection_dict_t& connection = canvas.connection_list[i];
+        if (connection.port_out_id == port_id)
+            return connection.port_in_id;
+        else
+            return connection.port_out_id;
     }
 
     qCritical("PatchCanvas::CanvasGetConnectedPort(%i, %i) - unable to find connection", connection_id, port_id);
@@ -1118,6 +1485,46 @@ void CanvasPostponedGroups()
         qDebug("PatchCanvas::CanvasPostponedGroups()");
 }
 
+void CanvasArrangeFinished()
+{
+    if (canvas.debug)
+        qDebug("PatchCanvas::CanvasArrangeFinished()");
+
+    // a stale signal from a run that clear() waited for, the new run will signal again
+    if (canvas.arrange_thread->isRunning())
+        return;
+
+    QVector<QPointF> positions = canvas.arrange_thread->getPositions();
+
+    // boxes are looked up again, groups removed or joined in the meantime are skipped
+    QList<CanvasBox*> moved_boxes;
+
+    for (int i=0; i < positions.count() && i < canvas.arrange_boxes.count(); i++)
+    {
+        const arrange_box_t& arrange_box = canvas.arrange_boxes[i];
+        const int group_idx = CanvasGetGroupIndex(arrange_box.group_id);
+
+        if (group_idx < 0)
+            continue;
+
+        const group_dict_t& group = canvas.group_list[group_idx];
+        CanvasBox* box = group.widgets[arrange_box.side];
+
+        if (! box || (arrange_box.side == 1 && ! group.split))
+            continue;
+
+        box->setPos(positions[i]);
+        moved_boxes.append(box);
+    }
+
+    foreach (CanvasBox* box, moved_boxes)
+        box->repaintLines(true);
+
+    canvas.arrange_boxes.clear();
+
+    CanvasUpdateScene();
+}
+
 void CanvasCallback(CallbackAction action, int value1, int value2, QString value_str)
 {
     if (canvas.debug)
@@ -1181,18 +1588,21 @@ void CanvasRemoveItemFX(QGraphicsItem* item)
         box->removeIconFromScene();
         canvas.scene->removeItem(box);
         delete box;
+        break;
     }
     case CanvasPortType:
     {
         CanvasPort* port = (CanvasPort*)item;
         canvas.scene->removeItem(port);
         delete port;
+        break;
     }
     case CanvasLineType:
     case CanvasBezierLineType:
     {
         AbstractCanvasLine* line = (AbstractCanvasLine*)item;
         line->deleteFromScene();
+        break;
     }
     default:
         break;
@@ -18,13 +18,17 @@
 #ifndef PATCHCANVAS_H
 #define PATCHCANVAS_H
 
-#include <QtGui/QGraphicsItem>
+#include <QtCore/QCache>
+#include <QtCore/QHash>
+#include <QtCore/QSet>
+#include <QtWidgets/QGraphicsItem>
 
-#include "../patchcanvas.h"
+#include "../patchcanvas.hpp"
 
 #define foreach2(var, list) \
     for (int i=0; i < list.count(); i++) { var = list[i];
 
+class QFontMetrics;
 class QSettings;
 class QTimer;
 
@@ -38,6 +42,7 @@ public slots:
     void AnimationIdle();
     void AnimationHide();
     void AnimationDestroy();
+    void ArrangeFinished();
     void CanvasPostponedGroups();
     void PortContextMenuDisconnect();
 };
@@ -45,6 +50,7 @@ public slots:
 START_NAMESPACE_PATCHCANVAS
 
 class AbstractCanvasLine;
+class CanvasArrange;
 class CanvasFadeAnimation;
 class CanvasBox;
 class CanvasPort;
@@ -61,6 +67,13 @@ enum CanvasType {
     CanvasBezierLineMovType = QGraphicsItem::UserType + 7
 };
 
+// fonts with cached text widths
+enum CanvasFont {
+    CanvasBoxFont  = 0,
+    CanvasPortFont = 1,
+    CanvasFontCount
+};
+
 // object lists
 struct group_dict_t {
     int group_id;
@@ -86,6 +99,11 @@ struct connection_dict_t {
     AbstractCanvasLine* widget;
 };
 
+struct arrange_box_t {
+    int group_id;
+    int side;  // index in group_dict_t::widgets
+};
+
 struct animation_dict_t {
     CanvasFadeAnimation* animation;
     QGraphicsItem* item;
@@ -108,6 +126,20 @@ public:
     QList<port_dict_t> port_list;
     QList<connection_dict_t> connection_list;
     QList<animation_dict_t> animation_list;
+    QHash<int, int> group_index;               // group_id -> group_list index
+    QHash<int, int> port_index;                // port_id -> port_list index
+    QHash<int, int> connection_index;          // connection_id -> connection_list index
+    QHash<int, QList<int> > group_ports;       // group_id -> port_ids
+    QHash<int, QList<int> > port_connections;  // port_id -> connection_ids
+    int update_depth;                          // nested beginUpdate() calls
+    QSet<CanvasBox*> pending_boxes;            // layouts deferred to endUpdate()
+    QList<int> pending_connections;            // lines deferred to endUpdate()
+    QCache<QString, int> text_widths[CanvasFontCount];  // least recently used names are dropped
+    QFontMetrics* text_metrics[CanvasFontCount];
+    QHash<CanvasBox*, QRectF> box_rects;            // scene rect of every box
+    QHash<qint64, QList<CanvasBox*> > box_grid;     // grid cell -> boxes overlapping it
+    CanvasArrange* arrange_thread;
+    QList<arrange_box_t> arrange_boxes;             // boxes being arranged, in the order given to the thread
     CanvasObject* qobject;
     QSettings* settings;
     Theme* theme;
@@ -120,6 +152,16 @@ const char* port_type2str(PortType port_type);
 const char* icon2str(Icon icon);
 const char* split2str(SplitOption split);
 
+int CanvasGetGroupIndex(int group_id);
+int CanvasGetPortIndex(int port_id);
+int CanvasGetConnectionIndex(int connection_id);
+AbstractCanvasLine* CanvasGetConnectionLine(int connection_id);
+int CanvasGetTextWidth(CanvasFont font, const QString& text);
+void CanvasResetTextWidths();
+void CanvasUpdateBox(CanvasBox* box);
+void CanvasUpdateBoxRect(CanvasBox* box);
+void CanvasRemoveBoxRect(CanvasBox* box);
+QList<CanvasBox*> CanvasGetBoxesAt(const QPointF& pos);
 QString CanvasGetGroupName(int group_id);
 int CanvasGetGroupPortCount(int group_id);
 QPointF CanvasGetNewGroupPos(bool horizontal=false);
@@ -128,6 +170,7 @@ QList<int> CanvasGetPortConnectionList(int port_id);
 int CanvasGetConnectedPort(int connection_id, int port_id);
 void CanvasRemoveAnimation(CanvasFadeAnimation* f_animation);
 void CanvasPostponedGroups();
+void CanvasArrangeFinished();
 void CanvasCallback(CallbackAction action, int value1, int value2, QString value_str);
 void CanvasItemFX(QGraphicsItem* item, bool show, bool destroy=false);
 void CanvasRemoveItemFX(QGraphicsItem* item);
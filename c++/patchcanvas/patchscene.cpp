@@ -19,10 +19,10 @@
 
 #include <cmath>
 #include <QtGui/QKeyEvent>
-#include <QtGui/QGraphicsRectItem>
-#include <QtGui/QGraphicsSceneMouseEvent>
-#include <QtGui/QGraphicsSceneWheelEvent>
-#include <QtGui/QGraphicsView>
+#include <QtWidgets/QGraphicsRectItem>
+#include <QtWidgets/QGraphicsSceneMouseEvent>
+#include <QtWidgets/QGraphicsSceneWheelEvent>
+#include <QtWidgets/QGraphicsView>
 
 #include "patchcanvas/patchcanvas.h"
 #include "patchcanvas/canvasbox.h"
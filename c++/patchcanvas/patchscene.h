@@ -18,7 +18,7 @@
 #ifndef PATCHSCENE_H
 #define PATCHSCENE_H
 
-#include <QtGui/QGraphicsScene>
+#include <QtWidgets/QGraphicsScene>
 
 class QKeyEvent;
 class QGraphicsRectItem;
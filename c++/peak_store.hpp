@@ -0,0 +1,82 @@
+/*
+ * Lock-free peak handoff between the JACK and GUI threads
+ * Copyright (C) 2012-2026 Filipe Coelho <falktx@falktx.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * For a full copy of the GNU General Public License see the COPYING file
+ */
+
+#ifndef PEAK_STORE_HPP
+#define PEAK_STORE_HPP
+
+#include <atomic>
+#include <stdint.h>
+
+// One atomic float per channel.
+// The RT thread only ever raises a value, the GUI takes it and resets it to zero in a single exchange.
+// A peak published between the GUI's read and reset can't exist, so no maximum is ever lost.
+class PeakStore
+{
+public:
+    PeakStore()
+        : fCount(0),
+          fPeaks(nullptr) {}
+
+    ~PeakStore()
+    {
+        if (fPeaks != nullptr)
+            delete[] fPeaks;
+    }
+
+    // not RT-safe, call before activating the client
+    void setCount(const uint32_t count)
+    {
+        if (fPeaks != nullptr)
+            delete[] fPeaks;
+
+        fCount = count;
+        fPeaks = (count > 0) ? new std::atomic<float>[count] : nullptr;
+
+        for (uint32_t i=0; i < count; ++i)
+            fPeaks[i].store(0.0f, std::memory_order_relaxed);
+    }
+
+    uint32_t getCount() const
+    {
+        return fCount;
+    }
+
+    // RT thread, once per period and channel
+    void publish(const uint32_t index, const float peak)
+    {
+        std::atomic<float>& slot(fPeaks[index]);
+        float current = slot.load(std::memory_order_relaxed);
+
+        // only fails if the GUI took the value in between, retry against the new (lower) one
+        while (peak > current && ! slot.compare_exchange_weak(current, peak, std::memory_order_release, std::memory_order_relaxed)) {}
+    }
+
+    // GUI thread, returns the highest value published since the last call
+    float take(const uint32_t index)
+    {
+        return fPeaks[index].exchange(0.0f, std::memory_order_acquire);
+    }
+
+private:
+    uint32_t fCount;
+    std::atomic<float>* fPeaks;
+
+    PeakStore(const PeakStore&);
+    PeakStore& operator=(const PeakStore&);
+};
+
+#endif // PEAK_STORE_HPP
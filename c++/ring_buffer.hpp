@@ -0,0 +1,144 @@
+/*
+ * Lock-free single producer, single consumer byte ring buffer
+ * Copyright (C) 2012-2026 Filipe Coelho <falktx@falktx.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * For a full copy of the GNU General Public License see the COPYING file
+ */
+
+#ifndef RING_BUFFER_HPP
+#define RING_BUFFER_HPP
+
+#include <atomic>
+#include <cstring>
+#include <stdint.h>
+
+// Byte ring with one writer and one reader thread, no locks and no allocation after setSize().
+// The size is a power of two, so positions are free-running counters masked on access.
+// Writes and reads are all-or-nothing, a record written in one call is always read back whole.
+class RingBuffer
+{
+public:
+    RingBuffer()
+        : fSize(0),
+          fMask(0),
+          fBuffer(nullptr),
+          fWritePos(0),
+          fReadPos(0) {}
+
+    ~RingBuffer()
+    {
+        if (fBuffer != nullptr)
+            delete[] fBuffer;
+    }
+
+    // not RT-safe, call before either thread uses the buffer; rounds up to a power of two
+    void setSize(const uint32_t minSize)
+    {
+        uint32_t size = 1;
+
+        while (size < minSize)
+            size <<= 1;
+
+        if (fBuffer != nullptr)
+            delete[] fBuffer;
+
+        fSize   = size;
+        fMask   = size - 1;
+        fBuffer = new uint8_t[size];
+
+        fWritePos.store(0, std::memory_order_relaxed);
+        fReadPos.store(0, std::memory_order_relaxed);
+    }
+
+    uint32_t getSize() const
+    {
+        return fSize;
+    }
+
+    // reader thread
+    uint32_t getReadSpace() const
+    {
+        return fWritePos.load(std::memory_order_acquire) - fReadPos.load(std::memory_order_relaxed);
+    }
+
+    // writer thread
+    uint32_t getWriteSpace() const
+    {
+        return fSize - (fWritePos.load(std::memory_order_relaxed) - fReadPos.load(std::memory_order_acquire));
+    }
+
+    // writer thread, returns false and writes nothing if there's not enough space
+    bool write(const void* const data, const uint32_t size)
+    {
+        if (size > getWriteSpace())
+            return false;
+
+        const uint32_t pos = fWritePos.load(std::memory_order_relaxed);
+        copyIn(pos, static_cast<const uint8_t*>(data), size);
+
+        fWritePos.store(pos + size, std::memory_order_release);
+        return true;
+    }
+
+    // reader thread, returns false and reads nothing if there's not enough data
+    bool read(void* const data, const uint32_t size)
+    {
+        if (! peek(data, size))
+            return false;
+
+        fReadPos.store(fReadPos.load(std::memory_order_relaxed) + size, std::memory_order_release);
+        return true;
+    }
+
+    // reader thread, same as read() but leaves the data in place
+    bool peek(void* const data, const uint32_t size) const
+    {
+        if (size > getReadSpace())
+            return false;
+
+        copyOut(fReadPos.load(std::memory_order_relaxed), static_cast<uint8_t*>(data), size);
+        return true;
+    }
+
+private:
+    uint32_t fSize;
+    uint32_t fMask;
+    uint8_t* fBuffer;
+
+    // free-running, wrap at 2^32 which is a multiple of any size
+    std::atomic<uint32_t> fWritePos;
+    std::atomic<uint32_t> fReadPos;
+
+    void copyIn(const uint32_t pos, const uint8_t* const data, const uint32_t size)
+    {
+        const uint32_t start = pos & fMask;
+        const uint32_t first = (size < fSize - start) ? size : fSize - start;
+
+        std::memcpy(fBuffer + start, data, first);
+        std::memcpy(fBuffer, data + first, size - first);
+    }
+
+    void copyOut(const uint32_t pos, uint8_t* const data, const uint32_t size) const
+    {
+        const uint32_t start = pos & fMask;
+        const uint32_t first = (size < fSize - start) ? size : fSize - start;
+
+        std::memcpy(data, fBuffer + start, first);
+        std::memcpy(data + first, fBuffer, size - first);
+    }
+
+    RingBuffer(const RingBuffer&);
+    RingBuffer& operator=(const RingBuffer&);
+};
+
+#endif // RING_BUFFER_HPP
@@ -32,8 +32,17 @@ DigitalPeakMeter::DigitalPeakMeter(QWidget* parent)
       fGradientMeter(0, 0, 1, 1),
       fColorBase(93, 231, 61),
       fColorBaseAlt(15, 110, 15, 100),
+      fPeakHoldTicks(0),
+      fPeakHoldDecay(0.0f),
+      fHistorySize(0),
       fChannelsData(nullptr),
-      fLastValueData(nullptr)
+      fLastValueData(nullptr),
+      fPeakHoldData(nullptr),
+      fPeakHoldCounters(nullptr),
+      fClipCounts(nullptr),
+      fHistoryPos(nullptr),
+      fHistoryCount(nullptr),
+      fHistoryData(nullptr)
 {
     setChannels(0);
     setColor(GREEN);
@@ -41,10 +50,7 @@ DigitalPeakMeter::DigitalPeakMeter(QWidget* parent)
 
 DigitalPeakMeter::~DigitalPeakMeter()
 {
-    if (fChannelsData != nullptr)
-        delete[] fChannelsData;
-    if (fLastValueData != nullptr)
-        delete[] fLastValueData;
+    deleteChannelData();
 }
 
 void DigitalPeakMeter::displayMeter(int meter, float level)
@@ -56,6 +62,11 @@ void DigitalPeakMeter::displayMeter(int meter, float level)
         return qCritical("DigitalPeakMeter::displayMeter(%i, %f) - invalid meter number", meter, level);
 
     int i = meter - 1;
+    bool changed = false;
+
+    // the cap is only drawn for the first clip, it doesn't need repainting after
+    if (level >= 1.0f && fClipCounts[i]++ == 0)
+        changed = true;
 
     if (fSmoothMultiplier > 0)
         level = (fLastValueData[i] * fSmoothMultiplier + level) / float(fSmoothMultiplier + 1);
@@ -68,10 +79,51 @@ void DigitalPeakMeter::displayMeter(int meter, float level)
     if (fChannelsData[i] != level)
     {
         fChannelsData[i] = level;
-        update();
+        changed = true;
     }
 
     fLastValueData[i] = level;
+
+    if (fPeakHoldTicks > 0)
+    {
+        float peakHold = fPeakHoldData[i];
+
+        if (level >= peakHold)
+        {
+            peakHold = level;
+            fPeakHoldCounters[i] = fPeakHoldTicks;
+        }
+        else if (fPeakHoldCounters[i] > 0)
+        {
+            --fPeakHoldCounters[i];
+        }
+        else
+        {
+            peakHold -= fPeakHoldDecay;
+
+            if (peakHold < level)
+                peakHold = level;
+        }
+
+        if (fPeakHoldData[i] != peakHold)
+        {
+            fPeakHoldData[i] = peakHold;
+            changed = true;
+        }
+    }
+
+    if (changed)
+        update(getChannelRect(i));
+
+    if (fHistorySize > 0)
+    {
+        fHistoryData[i*fHistorySize + fHistoryPos[i]] = level;
+
+        if (++fHistoryPos[i] == fHistorySize)
+            fHistoryPos[i] = 0;
+        if (fHistoryCount[i] < fHistorySize)
+            ++fHistoryCount[i];
+    }
 }
 
 void DigitalPeakMeter::setChannels(int channels)
@@ -81,29 +133,41 @@ void DigitalPeakMeter::setChannels(int channels)
     if (channels < 0)
         return qCritical("DigitalPeakMeter::setChannels(%i) - 'channels' must be a positive integer", channels);
 
-    fChannels = channels;
+    deleteChannelData();
 
-    if (fChannelsData != nullptr)
-        delete[] fChannelsData;
-    if (fLastValueData != nullptr)
-        delete[] fLastValueData;
+    fChannels = channels;
 
     if (channels > 0)
     {
-        fChannelsData  = new float[channels];
-        fLastValueData = new float[channels];
+        fChannelsData     = new float[channels];
+        fLastValueData    = new float[channels];
+        fPeakHoldData     = new float[channels];
+        fPeakHoldCounters = new int[channels];
+        fClipCounts       = new uint[channels];
+        fHistoryPos       = new int[channels];
+        fHistoryCount     = new int[channels];
 
         for (int i=0; i < channels; ++i)
         {
-            fChannelsData[i]  = 0.0f;
-            fLastValueData[i] = 0.0f;
+            fChannelsData[i]     = 0.0f;
+            fLastValueData[i]    = 0.0f;
+            fPeakHoldData[i]     = 0.0f;
+            fPeakHoldCounters[i] = 0;
+            fClipCounts[i]       = 0;
+            fHistoryPos[i]       = 0;
+            fHistoryCount[i]     = 0;
+        }
+
+        if (fHistorySize > 0)
+        {
+            fHistoryData = new float[channels*fHistorySize];
+
+            for (int i=0; i < channels*fHistorySize; ++i)
+                fHistoryData[i] = 0.0f;
         }
     }
-    else
-    {
-        fChannelsData  = nullptr;
-        fLastValueData = nullptr;
-    }
+
+    updateSizes();
 }
 
 void DigitalPeakMeter::setColor(Color color)
@@ -164,6 +228,114 @@ void DigitalPeakMeter::setSmoothRelease(int value)
     fSmoothMultiplier = value;
 }
 
+void DigitalPeakMeter::setPeakHold(int holdTicks, float decay)
+{
+    Q_ASSERT(holdTicks >= 0);
+
+    if (holdTicks < 0)
+        holdTicks = 0;
+
+    fPeakHoldTicks = holdTicks;
+    fPeakHoldDecay = decay;
+
+    for (int i=0; i < fChannels; ++i)
+    {
+        fPeakHoldData[i]     = 0.0f;
+        fPeakHoldCounters[i] = 0;
+    }
+
+    update();
+}
+
+float DigitalPeakMeter::getPeakHold(int meter) const
+{
+    Q_ASSERT(meter > 0 && meter <= fChannels);
+
+    if (meter <= 0 || meter > fChannels)
+        return 0.0f;
+
+    return fPeakHoldData[meter-1];
+}
+
+uint DigitalPeakMeter::getClipCount(int meter) const
+{
+    Q_ASSERT(meter > 0 && meter <= fChannels);
+
+    if (meter <= 0 || meter > fChannels)
+        return 0;
+
+    return fClipCounts[meter-1];
+}
+
+void DigitalPeakMeter::resetClipCounts()
+{
+    for (int i=0; i < fChannels; ++i)
+        fClipCounts[i] = 0;
+
+    update();
+}
+
+void DigitalPeakMeter::setHistorySize(int size)
+{
+    Q_ASSERT(size >= 0);
+
+    if (size < 0)
+        return qCritical("DigitalPeakMeter::setHistorySize(%i) - 'size' must be a positive integer", size);
+
+    if (fHistoryData != nullptr)
+    {
+        delete[] fHistoryData;
+        fHistoryData = nullptr;
+    }
+
+    fHistorySize = size;
+
+    for (int i=0; i < fChannels; ++i)
+    {
+        fHistoryPos[i]   = 0;
+        fHistoryCount[i] = 0;
+    }
+
+    if (size > 0 && fChannels > 0)
+    {
+        fHistoryData = new float[fChannels*size];
+
+        for (int i=0; i < fChannels*size; ++i)
+            fHistoryData[i] = 0.0f;
+    }
+}
+
+int DigitalPeakMeter::getHistorySize() const
+{
+    return fHistorySize;
+}
+
+int DigitalPeakMeter::getHistoryCount(int meter) const
+{
+    Q_ASSERT(meter > 0 && meter <= fChannels);
+
+    if (meter <= 0 || meter > fChannels)
+        return 0;
+
+    return fHistoryCount[meter-1];
+}
+
+float DigitalPeakMeter::getHistoryValue(int meter, int age) const
+{
+    Q_ASSERT(meter > 0 && meter <= fChannels);
+
+    if (meter <= 0 || meter > fChannels || age < 0 || age >= fHistoryCount[meter-1])
+        return 0.0f;
+
+    const int i = meter - 1;
+    int pos = fHistoryPos[i] - 1 - age;
+
+    if (pos < 0)
+        pos += fHistorySize;
+
+    return fHistoryData[i*fHistorySize + pos];
+}
+
 QSize DigitalPeakMeter::minimumSizeHint() const
 {
     return QSize(10, 10);
@@ -194,40 +366,49 @@ void DigitalPeakMeter::updateSizes()
         if (fChannels > 0)
             fSizeMeter = fWidth/fChannels;
     }
+
+    updatePixmaps();
 }
 
-void DigitalPeakMeter::paintEvent(QPaintEvent* event)
+void DigitalPeakMeter::updatePixmaps()
 {
-    QPainter painter(this);
-    event->accept();
-
-    painter.setPen(Qt::black);
-    painter.setBrush(Qt::black);
-    painter.drawRect(0, 0, fWidth, fHeight);
-
-    int meterX = 0;
-    painter.setPen(fColorBackground);
-    painter.setBrush(fGradientMeter);
+    if (fWidth <= 0 || fHeight <= 0)
+    {
+        fPixmapEmpty = QPixmap();
+        fPixmapFull  = QPixmap();
+        return;
+    }
 
-    for (int i=0; i < fChannels; ++i)
+    // what the meter looks like with all channels silent
+    fPixmapEmpty = QPixmap(fWidth, fHeight);
+    fPixmapEmpty.fill(Qt::black);
     {
-        float value, level = fChannelsData[i];
+        QPainter painter(&fPixmapEmpty);
+        paintScale(painter);
+    }
 
-        if (fOrientation == HORIZONTAL)
-            value = level * float(fWidth);
-        else if (fOrientation == VERTICAL)
-            value = float(fHeight) - (level * float(fHeight));
-        else
-            value = 0.0f;
+    // and with all channels at full scale, the bars are copied out of this one
+    fPixmapFull = QPixmap(fWidth, fHeight);
+    fPixmapFull.fill(Qt::black);
+    {
+        QPainter painter(&fPixmapFull);
+        painter.setPen(fColorBackground);
+        painter.setBrush(fGradientMeter);
 
-        if (fOrientation == HORIZONTAL)
-            painter.drawRect(0, meterX, int(value), fSizeMeter);
-        else if (fOrientation == VERTICAL)
-            painter.drawRect(meterX, int(value), fSizeMeter, fHeight);
+        for (int i=0; i < fChannels; ++i)
+        {
+            if (fOrientation == HORIZONTAL)
+                painter.drawRect(0, i*fSizeMeter, fWidth, fSizeMeter);
+            else if (fOrientation == VERTICAL)
+                painter.drawRect(i*fSizeMeter, 0, fSizeMeter, fHeight);
+        }
 
-        meterX += fSizeMeter;
+        paintScale(painter);
     }
+}
 
+void DigitalPeakMeter::paintScale(QPainter& painter)
+{
     painter.setBrush(Qt::black);
 
     if (fOrientation == HORIZONTAL)
@@ -281,6 +462,110 @@ void DigitalPeakMeter::paintEvent(QPaintEvent* event)
     }
 }
 
+QRect DigitalPeakMeter::getChannelRect(int index) const
+{
+    if (fOrientation == HORIZONTAL)
+        return QRect(0, index*fSizeMeter, fWidth, fSizeMeter);
+
+    return QRect(index*fSizeMeter, 0, fSizeMeter, fHeight);
+}
+
+void DigitalPeakMeter::deleteChannelData()
+{
+    if (fChannelsData != nullptr)
+        delete[] fChannelsData;
+    if (fLastValueData != nullptr)
+        delete[] fLastValueData;
+    if (fPeakHoldData != nullptr)
+        delete[] fPeakHoldData;
+    if (fPeakHoldCounters != nullptr)
+        delete[] fPeakHoldCounters;
+    if (fClipCounts != nullptr)
+        delete[] fClipCounts;
+    if (fHistoryPos != nullptr)
+        delete[] fHistoryPos;
+    if (fHistoryCount != nullptr)
+        delete[] fHistoryCount;
+    if (fHistoryData != nullptr)
+        delete[] fHistoryData;
+
+    fChannelsData     = nullptr;
+    fLastValueData    = nullptr;
+    fPeakHoldData     = nullptr;
+    fPeakHoldCounters = nullptr;
+    fClipCounts       = nullptr;
+    fHistoryPos       = nullptr;
+    fHistoryCount     = nullptr;
+    fHistoryData      = nullptr;
+}
+
+void DigitalPeakMeter::paintEvent(QPaintEvent* event)
+{
+    QPainter painter(this);
+    event->accept();
+
+    if (fPixmapEmpty.isNull() || fPixmapFull.isNull())
+    {
+        painter.fillRect(rect(), Qt::black);
+        return;
+    }
+
+    // empty meters over the whole dirty area, then the filled part of each dirty channel
+    const QRect dirtyRect(event->rect());
+    const QRegion dirtyRegion(event->region());
+
+    painter.drawPixmap(dirtyRect, fPixmapEmpty, dirtyRect);
+
+    for (int i=0; i < fChannels; ++i)
+    {
+        const QRect channelRect(getChannelRect(i));
+
+        if (! dirtyRegion.intersects(channelRect))
+            continue;
+
+        const float level = fChannelsData[i];
+
+        if (level > 0.0f)
+        {
+            QRect levelRect(channelRect);
+
+            if (fOrientation == HORIZONTAL)
+                levelRect.setWidth(int(level * float(fWidth)));
+            else if (fOrientation == VERTICAL)
+                levelRect.setTop(int(float(fHeight) - level * float(fHeight)));
+
+            painter.drawPixmap(levelRect, fPixmapFull, levelRect);
+        }
+
+        // peak-hold marker, and a red cap on channels that reached full scale
+        const float peakHold = fPeakHoldData[i];
+
+        if (fPeakHoldTicks > 0 && peakHold > 0.0f)
+        {
+            painter.setPen(peakHold >= 0.999f ? Qt::red : Qt::white);
+
+            if (fOrientation == HORIZONTAL)
+            {
+                const int x = int(peakHold * float(fWidth-1));
+                painter.drawLine(x, channelRect.top()+1, x, channelRect.bottom());
+            }
+            else if (fOrientation == VERTICAL)
+            {
+                const int y = int(float(fHeight-1) - peakHold * float(fHeight-1));
+                painter.drawLine(channelRect.left()+1, y, channelRect.right(), y);
+            }
+        }
+
+        if (fClipCounts[i] > 0)
+        {
+            if (fOrientation == HORIZONTAL)
+                painter.fillRect(fWidth-3, channelRect.top(), 3, fSizeMeter, Qt::red);
+            else if (fOrientation == VERTICAL)
+                painter.fillRect(channelRect.left(), 0, fSizeMeter, 3, Qt::red);
+        }
+    }
+}
+
 void DigitalPeakMeter::resizeEvent(QResizeEvent* event)
 {
     updateSizes();
@@ -19,8 +19,11 @@
 #define __DIGITALPEAKMETER_HPP__
 
 #include <QtCore/QTimer>
+#include <QtGui/QPixmap>
 #include <QtWidgets/QWidget>
 
+class QPainter;
+
 class DigitalPeakMeter : public QWidget
 {
 public:
@@ -43,11 +46,31 @@ public:
     void setOrientation(Orientation orientation);
     void setSmoothRelease(int value);
 
+    // hold each channel's highest level for 'holdTicks' displayMeter() calls,
+    // then let it fall by 'decay' per call; 0 ticks disables the markers
+    void setPeakHold(int holdTicks, float decay);
+    float getPeakHold(int meter) const;
+
+    // number of displayMeter() calls that reached full scale
+    uint getClipCount(int meter) const;
+    void resetClipCounts();
+
+    // last 'size' displayed levels per channel, for drawing level over time
+    void setHistorySize(int size);
+    int getHistorySize() const;
+    int getHistoryCount(int meter) const;
+    float getHistoryValue(int meter, int age) const; // age 0 is the newest
+
     QSize minimumSizeHint() const;
     QSize sizeHint() const;
 
 protected:
     void updateSizes();
+    void updatePixmaps();
+    void paintScale(QPainter& painter);
+    void deleteChannelData();
+
+    QRect getChannelRect(int index) const;
 
     void paintEvent(QPaintEvent* event);
     void resizeEvent(QResizeEvent* event);
@@ -64,8 +87,25 @@ private:
     QColor fColorBase;
     QColor fColorBaseAlt;
 
+    // static layers, only redrawn in updateSizes()
+    QPixmap fPixmapEmpty;
+    QPixmap fPixmapFull;
+
+    int   fPeakHoldTicks;
+    float fPeakHoldDecay;
+    int   fHistorySize;
+
+    // one array per field, 'fChannels' long
     float* fChannelsData;
     float* fLastValueData;
+    float* fPeakHoldData;
+    int*   fPeakHoldCounters;
+    uint*  fClipCounts;
+    int*   fHistoryPos;
+    int*   fHistoryCount;
+
+    // 'fHistorySize' values per channel, one channel after the other
+    float* fHistoryData;
 };
 
 #endif // __DIGITALPEAKMETER_HPP__
@@ -0,0 +1,330 @@
+/*
+ * XY Controller, benchmark for the MIDI queues
+ * Copyright (C) 2012-2026 Filipe Coelho <falktx@falktx.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * For a full copy of the GNU General Public License see the COPYING file
+ */
+
+#include "../midi_queue.hpp"
+
+#include <QtCore/QMutex>
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <thread>
+
+#ifdef __linux__
+# include <pthread.h>
+# include <sched.h>
+#endif
+
+// -------------------------------
+// The mutex based Queue from before the lock-free one
+
+class MutexQueue
+{
+public:
+    MutexQueue()
+    {
+        index = 0;
+        empty = true;
+        full  = false;
+    }
+
+    bool isEmpty()
+    {
+        return empty;
+    }
+
+    bool isFull()
+    {
+        return full;
+    }
+
+    void put(unsigned char d1, unsigned char d2, unsigned char d3)
+    {
+        if (full || d1 == 0)
+            return;
+
+        mutex.lock();
+
+        for (unsigned short i=0; i < MAX_SIZE; i++)
+        {
+            if (data[i].d1 == 0)
+            {
+                data[i].d1 = d1;
+                data[i].d2 = d2;
+                data[i].d3 = d3;
+                empty = false;
+                full  = (i == MAX_SIZE-1);
+                break;
+            }
+        }
+
+        mutex.unlock();
+    }
+
+    bool get(unsigned char* d1, unsigned char* d2, unsigned char* d3)
+    {
+        if (empty)
+            return false;
+
+        mutex.lock();
+
+        full = false;
+
+        if (data[index].d1 == 0)
+        {
+            index = 0;
+            empty = true;
+            mutex.unlock();
+            return false;
+        }
+
+        *d1 = data[index].d1;
+        *d2 = data[index].d2;
+        *d3 = data[index].d3;
+
+        data[index].d1 = data[index].d2 = data[index].d3 = 0;
+        index++;
+        empty = false;
+
+        mutex.unlock();
+        return true;
+    }
+
+private:
+    struct datatype {
+        unsigned char d1, d2, d3;
+
+        datatype()
+            : d1(0), d2(0), d3(0) {}
+    };
+
+    static const unsigned short MAX_SIZE = 512;
+    datatype data[MAX_SIZE];
+    unsigned short index;
+    volatile bool empty, full;
+
+    QMutex mutex;
+};
+
+// -------------------------------
+
+static const uint32_t kThroughputEvents = 2*1000*1000;
+static const uint32_t kLatencyRounds    = 100*1000;
+
+static void pin_to_cpu(const int cpu)
+{
+#ifdef __linux__
+    if (cpu >= int(std::thread::hardware_concurrency()))
+        return;
+
+    cpu_set_t cpuset;
+    CPU_ZERO(&cpuset);
+    CPU_SET(cpu, &cpuset);
+    pthread_setaffinity_np(pthread_self(), sizeof(cpuset), &cpuset);
+#else
+    (void)cpu;
+#endif
+}
+
+// both queue types have the same put/get, the old one just can't say if a put worked
+static bool put_event(Queue& queue, const uint32_t i)
+{
+    return queue.put(0x90 | (i & 0x0F), i & 0x7F, (i >> 7) & 0x7F);
+}
+
+static bool put_event(MutexQueue& queue, const uint32_t i)
+{
+    if (queue.isFull())
+        return false;
+
+    queue.put(0x90 | (i & 0x0F), i & 0x7F, (i >> 7) & 0x7F);
+    return true;
+}
+
+// the old queue only rewinds when get() fails, xycontroller always drained it so do the same here
+static bool get_single_event(Queue& queue)
+{
+    unsigned char d1, d2, d3;
+    return queue.get(&d1, &d2, &d3);
+}
+
+static bool get_single_event(MutexQueue& queue)
+{
+    unsigned char d1, d2, d3;
+
+    if (! queue.get(&d1, &d2, &d3))
+        return false;
+
+    queue.get(&d1, &d2, &d3);
+    return true;
+}
+
+// producer on one core, consumer on another, returns million events per second
+template<class Q>
+static double bench_throughput(uint32_t& errors, uint32_t& lost)
+{
+    Q* const queue = new Q();
+    std::atomic<bool> done(false);
+
+    std::thread producer([queue, &done] {
+        pin_to_cpu(1);
+
+        for (uint32_t i=0; i < kThroughputEvents;)
+        {
+            if (put_event(*queue, i))
+                ++i;
+            else
+                std::this_thread::yield();
+        }
+
+        done = true;
+    });
+
+    pin_to_cpu(0);
+
+    const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+    unsigned char d1, d2, d3;
+    uint32_t received = 0;
+    errors = 0;
+
+    for (;;)
+    {
+        // checked before get(), so nothing put before 'done' can be missed
+        const bool producerDone = done;
+
+        if (! queue->get(&d1, &d2, &d3))
+        {
+            if (producerDone)
+                break;
+
+            std::this_thread::yield();
+            continue;
+        }
+
+        if (d2 != (received & 0x7F) || d3 != ((received >> 7) & 0x7F))
+            ++errors;
+
+        ++received;
+    }
+
+    const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+    producer.join();
+    delete queue;
+
+    lost = kThroughputEvents - received;
+
+    return received / elapsed.count() / 1e6;
+}
+
+// ping-pong between two threads, returns the average one-way time in ns
+template<class Q>
+static double bench_latency()
+{
+    Q* const ping = new Q();
+    Q* const pong = new Q();
+
+    std::thread echo([ping, pong] {
+        pin_to_cpu(1);
+
+        for (uint32_t i=0; i < kLatencyRounds; ++i)
+        {
+            while (! get_single_event(*ping)) {}
+            while (! put_event(*pong, i)) {}
+        }
+    });
+
+    pin_to_cpu(0);
+
+    const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+    for (uint32_t i=0; i < kLatencyRounds; ++i)
+    {
+        while (! put_event(*ping, i)) {}
+        while (! get_single_event(*pong)) {}
+    }
+
+    const std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+
+    echo.join();
+    delete ping;
+    delete pong;
+
+    return elapsed.count() / kLatencyRounds / 2.0;
+}
+
+// fills the queue up to 'depth' events and drains it again, returns ns per event
+template<class Q>
+static double bench_depth(const uint32_t depth)
+{
+    Q* const queue = new Q();
+
+    const uint32_t iterations = 4*1024*1024 / depth;
+    const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+    unsigned char d1, d2, d3;
+
+    for (uint32_t i=0; i < iterations; ++i)
+    {
+        for (uint32_t j=0; j < depth; ++j)
+            put_event(*queue, j);
+
+        while (queue->get(&d1, &d2, &d3)) {}
+    }
+
+    const std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+
+    delete queue;
+
+    return elapsed.count() / iterations / depth;
+}
+
+// -------------------------------
+
+int main()
+{
+    std::printf("MIDI queues, %u cpus\n", std::thread::hardware_concurrency());
+
+    if (std::thread::hardware_concurrency() < 2)
+        std::printf("only one cpu, producer and consumer will share it and latency is meaningless\n");
+
+    uint32_t mutexErrors, mutexLost, lockFreeErrors, lockFreeLost;
+
+    const double mutexThroughput    = bench_throughput<MutexQueue>(mutexErrors, mutexLost);
+    const double lockFreeThroughput = bench_throughput<Queue>(lockFreeErrors, lockFreeLost);
+
+    std::printf("\n%12s %16s %16s\n", "", "mutex", "lock-free");
+    std::printf("%12s %16.2f %16.2f\n", "Mevents/s", mutexThroughput, lockFreeThroughput);
+
+    if (std::thread::hardware_concurrency() >= 2)
+        std::printf("%12s %16.1f %16.1f\n", "latency ns", bench_latency<MutexQueue>(), bench_latency<Queue>());
+
+    // the old queue can lose or reorder events when 'empty' is reset while the producer refills slot 0
+    std::printf("%12s %16u %16u\n", "out of order", mutexErrors, lockFreeErrors);
+    std::printf("%12s %16u %16u\n", "lost", mutexLost, lockFreeLost);
+
+    // cost per event should not depend on how many are queued
+    std::printf("\nput + get, single thread\n");
+    std::printf("%12s %16s %16s\n", "queued", "mutex (ns)", "lock-free (ns)");
+
+    for (uint32_t depth = 1; depth <= 512; depth *= 2)
+        std::printf("%12u %16.1f %16.1f\n", depth, bench_depth<MutexQueue>(depth), bench_depth<Queue>(depth));
+
+    return 0;
+}
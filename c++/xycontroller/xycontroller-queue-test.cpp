@@ -0,0 +1,278 @@
+/*
+ * XY Controller, unit test for the lock-free MIDI queue and the CC coalescer
+ * Copyright (C) 2012-2026 Filipe Coelho <falktx@falktx.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * For a full copy of the GNU General Public License see the COPYING file
+ */
+
+#include "../midi_queue.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <thread>
+
+// -------------------------------
+
+static uint32_t gChecks   = 0;
+static uint32_t gFailures = 0;
+
+#define CHECK(cond)                                                                        \
+    do {                                                                                   \
+        ++gChecks;                                                                         \
+        if (! (cond))                                                                      \
+        {                                                                                  \
+            std::fprintf(stderr, "%s:%i: check failed: %s\n", __FILE__, __LINE__, #cond); \
+            ++gFailures;                                                                   \
+        }                                                                                  \
+    } while (false)
+
+// small, so the tests go around the ring many times
+typedef LockFreeQueue<uint32_t, 8> SmallQueue;
+
+// -------------------------------
+
+static void test_empty()
+{
+    SmallQueue queue;
+    uint32_t value = 0;
+
+    CHECK(queue.isEmpty());
+    CHECK(! queue.isFull());
+    CHECK(queue.getCount() == 0);
+    CHECK(! queue.get(value));
+
+    CHECK(queue.put(1));
+    CHECK(queue.get(value) && value == 1);
+
+    // empty again, nothing left behind
+    CHECK(queue.isEmpty());
+    CHECK(! queue.get(value));
+}
+
+static void test_fifo()
+{
+    SmallQueue queue;
+    uint32_t value = 0;
+
+    for (uint32_t i=0; i < 5; ++i)
+        CHECK(queue.put(100 + i));
+
+    CHECK(queue.getCount() == 5);
+
+    for (uint32_t i=0; i < 5; ++i)
+        CHECK(queue.get(value) && value == 100 + i);
+
+    CHECK(! queue.get(value));
+}
+
+static void test_full()
+{
+    SmallQueue queue;
+    uint32_t value = 0;
+
+    // every slot can be used
+    for (uint32_t i=0; i < SmallQueue::kSize; ++i)
+        CHECK(queue.put(i));
+
+    CHECK(queue.isFull());
+    CHECK(queue.getCount() == SmallQueue::kSize);
+
+    // the newest value is the one dropped, and counted
+    CHECK(! queue.put(99));
+    CHECK(queue.getDroppedCount() == 1);
+
+    CHECK(queue.get(value) && value == 0);
+    CHECK(! queue.isFull());
+    CHECK(queue.put(8));
+
+    for (uint32_t i=1; i <= SmallQueue::kSize; ++i)
+        CHECK(queue.get(value) && value == i);
+
+    CHECK(queue.isEmpty());
+    CHECK(queue.getDroppedCount() == 1);
+}
+
+static void test_wraparound()
+{
+    SmallQueue queue;
+    uint32_t next = 0, expected = 0, value = 0;
+
+    // varying fill levels, so reads and writes cross the end of the buffer at every offset
+    for (uint32_t round=0; round < 1000; ++round)
+    {
+        const uint32_t count = round % (SmallQueue::kSize + 1);
+
+        for (uint32_t i=0; i < count; ++i)
+            CHECK(queue.put(next++));
+
+        CHECK(queue.getCount() == count);
+
+        for (uint32_t i=0; i < count; ++i)
+            CHECK(queue.get(value) && value == expected++);
+
+        CHECK(queue.isEmpty());
+    }
+
+    CHECK(queue.getDroppedCount() == 0);
+}
+
+static void test_drain()
+{
+    SmallQueue queue;
+    uint32_t values[SmallQueue::kSize] = { 0 };
+    uint32_t next = 0, expected = 0;
+
+    CHECK(queue.drain(values, SmallQueue::kSize) == 0);
+
+    // takes exactly what's there, oldest first, also across the end of the buffer
+    for (uint32_t round=0; round < 100; ++round)
+    {
+        const uint32_t count = round % SmallQueue::kSize + 1;
+
+        for (uint32_t i=0; i < count; ++i)
+            CHECK(queue.put(next++));
+
+        CHECK(queue.drain(values, SmallQueue::kSize) == count);
+
+        for (uint32_t i=0; i < count; ++i)
+            CHECK(values[i] == expected++);
+
+        CHECK(queue.isEmpty());
+    }
+
+    // never more than asked for, the rest stays queued
+    for (uint32_t i=0; i < 5; ++i)
+        CHECK(queue.put(i));
+
+    CHECK(queue.drain(values, 3) == 3);
+    CHECK(values[0] == 0 && values[2] == 2);
+    CHECK(queue.getCount() == 2);
+    CHECK(queue.drain(values, SmallQueue::kSize) == 2);
+    CHECK(values[0] == 3 && values[1] == 4);
+}
+
+static void test_midi_queue()
+{
+    Queue queue;
+    unsigned char d1 = 0, d2 = 0, d3 = 0;
+    uint32_t time = 0;
+
+    CHECK(queue.put(0x90, 60, 100, 1234));
+    CHECK(queue.put(0x80, 60, 0));
+
+    CHECK(queue.get(&d1, &d2, &d3, &time));
+    CHECK(d1 == 0x90 && d2 == 60 && d3 == 100 && time == 1234);
+
+    // time is optional on both sides
+    CHECK(queue.get(&d1, &d2, &d3));
+    CHECK(d1 == 0x80 && d2 == 60 && d3 == 0);
+
+    CHECK(! queue.get(&d1, &d2, &d3));
+}
+
+static void test_coalescer()
+{
+    ControlChangeCoalescer coalescer;
+    MidiData events[ControlChangeCoalescer::kMaxEvents];
+
+    // only the latest value of a control goes out
+    coalescer.put(0, 1, 10, CONTROL_7BIT, 100);
+    coalescer.put(0, 1, 20, CONTROL_7BIT, 200);
+    CHECK(coalescer.drain(events, ControlChangeCoalescer::kMaxEvents, 64) == 1);
+    CHECK(events[0].d1 == 0xB0 && events[0].d2 == 1 && events[0].d3 == 20 && events[0].time == 200);
+    CHECK(coalescer.drain(events, ControlChangeCoalescer::kMaxEvents, 64) == 0);
+
+    // what didn't fit goes out next period, the interval waits until everything was sent
+    coalescer.setInterval(1000);
+
+    for (unsigned char control=0; control < 3; ++control)
+        coalescer.put(2, control, 64, CONTROL_7BIT, 0);
+
+    CHECK(coalescer.drain(events, 2, 64) == 2);
+    CHECK(coalescer.drain(events, 2, 64) == 1);
+    CHECK(events[0].d1 == 0xB2 && events[0].d2 == 2);
+
+    // now it's armed, a new value waits for the interval
+    coalescer.put(2, 0, 1, CONTROL_7BIT, 0);
+
+    uint32_t frames = 0, count = 0;
+
+    while (count == 0 && frames < 2000)
+    {
+        count = coalescer.drain(events, ControlChangeCoalescer::kMaxEvents, 64);
+        frames += 64;
+    }
+
+    CHECK(count == 1);
+    CHECK(frames >= 1000 && frames <= 1000 + 64);
+}
+
+// producer and consumer on different threads, everything arrives once and in order
+static void test_threads()
+{
+    static const uint32_t kEvents = 200*1000;
+
+    Queue* const queue = new Queue();
+
+    std::thread producer([queue] {
+        for (uint32_t i=0; i < kEvents;)
+        {
+            if (queue->put(0x90, i & 0x7F, 100, i))
+                ++i;
+            else
+                std::this_thread::sleep_for(std::chrono::microseconds(10));
+        }
+    });
+
+    unsigned char d1 = 0, d2 = 0, d3 = 0;
+    uint32_t expected = 0, errors = 0, time = 0;
+
+    while (expected < kEvents)
+    {
+        if (! queue->get(&d1, &d2, &d3, &time))
+        {
+            std::this_thread::sleep_for(std::chrono::microseconds(10));
+            continue;
+        }
+
+        if (time != expected || d2 != (expected & 0x7F))
+            ++errors;
+
+        expected = time + 1;
+    }
+
+    producer.join();
+
+    CHECK(errors == 0);
+    CHECK(queue->isEmpty());
+
+    delete queue;
+}
+
+// -------------------------------
+
+int main()
+{
+    test_empty();
+    test_fifo();
+    test_full();
+    test_wraparound();
+    test_drain();
+    test_midi_queue();
+    test_coalescer();
+    test_threads();
+
+    std::printf("lock-free queue: %u checks, %u failures\n", gChecks, gFailures);
+
+    return (gFailures == 0) ? 0 : 1;
+}
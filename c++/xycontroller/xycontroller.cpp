@@ -27,29 +27,605 @@
 #include "../midi_queue.hpp"
 #include "ui_xycontroller.h"
 
+#include <QtCore/QFile>
 #include <QtCore/QSettings>
+#include <QtCore/QThread>
 #include <QtCore/QTimer>
 #include <QtGui/QKeyEvent>
+#include <QtWidgets/QActionGroup>
 #include <QtWidgets/QApplication>
+#include <QtWidgets/QFileDialog>
 #include <QtWidgets/QGraphicsItem>
 #include <QtWidgets/QGraphicsScene>
 #include <QtWidgets/QGraphicsSceneEvent>
 #include <QtWidgets/QMainWindow>
 #include <QtWidgets/QMessageBox>
 
-// -------------------------------
+#include <cmath>
+#include <cstring>
 
-float abs_f(const float value)
-{
-    return (value < 1.0f) ? -value : value;
-}
+#ifndef Q_OS_WIN
+# include <csignal>
+# include <unistd.h>
+#endif
+
+// -------------------------------
 
 jack_client_t* jClient = nullptr;
 jack_port_t* jMidiInPort  = nullptr;
 jack_port_t* jMidiOutPort = nullptr;
 
-static Queue qMidiInData;
+// incoming channel messages, kept whole; system messages are passed through by process_callback
+static MidiEventRing<65536> qMidiInData;
+// notes from the GUI keyboard, only ever 3-byte channel messages, so the fixed-size queue is enough
 static Queue qMidiOutData;
+static ControlChangeCoalescer qMidiOutCC;
+
+// GUI side timestamp for outgoing events, the estimated JACK frame of right now
+static jack_nframes_t midi_out_time()
+{
+    return (jClient != nullptr) ? jackbridge_frame_time(jClient) : 0;
+}
+
+// -1..1 position to controller value, lowers 'resolution' if 'control' can't do it
+static int get_control_value(const float pos, const int control, ControlResolution& resolution)
+{
+    // only CCs 0-31 have an LSB partner
+    if (resolution == CONTROL_14BIT && control >= 0x20)
+        resolution = CONTROL_7BIT;
+
+    int value;
+
+    if (resolution == CONTROL_7BIT)
+    {
+        float rate = float(0xff) / 4;
+        value = pos * rate + rate;
+
+        if (value > 0x7F)
+            value = 0x7F;
+    }
+    else
+    {
+        float rate = float(0x3FFF) / 2;
+        value = pos * rate + rate + 0.5f;
+
+        if (value > 0x3FFF)
+            value = 0x3FFF;
+    }
+
+    if (value < 0)
+        value = 0;
+
+    return value;
+}
+
+// -------------------------------
+
+// Cursor smoothing, run by the JACK thread once per period.
+// The GUI only sets where the cursor should go, the ramp towards it and the CCs it produces
+// happen in process_callback, so they don't depend on the GUI timer or on the GUI being responsive.
+// It's a one-pole filter with the same ~225 ms time constant the old 30 ms GUI steps of 1/8 had.
+class XYSmoother
+{
+public:
+    static const int kAxisX = 0;
+    static const int kAxisY = 1;
+
+    XYSmoother()
+        : fEnabled(false),
+          fChannels(0),
+          fResolution(CONTROL_7BIT),
+          fSampleRate(48000.0),
+          fCoefFrames(0),
+          fCoef(0.0f)
+    {
+        for (int i=0; i < 2; ++i)
+        {
+            fAxes[i].target.store(0.0f, std::memory_order_relaxed);
+            fAxes[i].current.store(0.0f, std::memory_order_relaxed);
+            fAxes[i].jump.store(false, std::memory_order_relaxed);
+            fAxes[i].control.store(i+1, std::memory_order_relaxed);
+            fAxes[i].lastValue = -1;
+        }
+    }
+
+    // call before the JACK client is activated
+    void setSampleRate(const double sampleRate)
+    {
+        fSampleRate = sampleRate;
+    }
+
+    // GUI thread, the setters below can be called at any time
+
+    void setEnabled(const bool enabled)
+    {
+        fEnabled.store(enabled, std::memory_order_release);
+    }
+
+    void setControl(const int axis, const int control)
+    {
+        fAxes[axis].control.store(control, std::memory_order_relaxed);
+    }
+
+    void setChannels(const QList<int>& channels)
+    {
+        uint32_t mask = 0;
+
+        foreach (const int& channel, channels)
+        {
+            if (channel >= 1 && channel <= 16)
+                mask |= 1 << (channel - 1);
+        }
+
+        fChannels.store(mask, std::memory_order_relaxed);
+    }
+
+    void setResolution(const ControlResolution resolution)
+    {
+        fResolution.store(resolution, std::memory_order_relaxed);
+    }
+
+    // ramps towards 'pos', -1..1
+    void setTarget(const int axis, const float pos)
+    {
+        fAxes[axis].target.store(pos, std::memory_order_relaxed);
+    }
+
+    // moves straight to 'pos' without sending anything, for values that were already sent or came from MIDI In
+    void jump(const int axis, const float pos)
+    {
+        fAxes[axis].target.store(pos, std::memory_order_relaxed);
+        fAxes[axis].jump.store(true, std::memory_order_release);
+    }
+
+    // where the ramp currently is, for the GUI to show
+    float getPosition(const int axis) const
+    {
+        return fAxes[axis].current.load(std::memory_order_relaxed);
+    }
+
+    // JACK thread, 'time' is the frame time the CCs are stamped with
+    void process(const jack_nframes_t nframes, const jack_nframes_t time)
+    {
+        const bool enabled = fEnabled.load(std::memory_order_acquire);
+
+        if (enabled && fCoefFrames != nframes)
+        {
+            fCoefFrames = nframes;
+            fCoef = 1.0f - std::exp(-double(nframes) / (0.225 * fSampleRate));
+        }
+
+        const uint32_t channels = fChannels.load(std::memory_order_relaxed);
+        const ControlResolution resolution = ControlResolution(fResolution.load(std::memory_order_relaxed));
+
+        for (int i=0; i < 2; ++i)
+        {
+            Axis& axis(fAxes[i]);
+
+            const float target = axis.target.load(std::memory_order_relaxed);
+            float current = axis.current.load(std::memory_order_relaxed);
+            bool send = true;
+
+            // jumps are followed even without smoothing, so the position here is always what was last sent
+            if (axis.jump.exchange(false, std::memory_order_acquire))
+            {
+                current = target;
+                send = false;
+            }
+            else if (! enabled)
+            {
+                continue;
+            }
+            else if (current != target)
+            {
+                current += fCoef * (target - current);
+
+                if (std::fabs(target - current) <= 0.0005f)
+                    current = target;
+            }
+
+            output(axis, current, time, send, channels, resolution);
+        }
+    }
+
+    // JACK thread, moves straight to x, y and sends it, for automation playback
+    void setPosition(const float x, const float y, const jack_nframes_t time)
+    {
+        const uint32_t channels = fChannels.load(std::memory_order_relaxed);
+        const ControlResolution resolution = ControlResolution(fResolution.load(std::memory_order_relaxed));
+
+        fAxes[kAxisX].target.store(x, std::memory_order_relaxed);
+        fAxes[kAxisY].target.store(y, std::memory_order_relaxed);
+
+        output(fAxes[kAxisX], x, time, true, channels, resolution);
+        output(fAxes[kAxisY], y, time, true, channels, resolution);
+    }
+
+private:
+    struct Axis {
+        std::atomic<float> target;
+        std::atomic<float> current; // written by the JACK thread only
+        std::atomic<bool>  jump;
+        std::atomic<int>   control;
+        int lastValue;              // JACK thread only
+    };
+
+    std::atomic<bool> fEnabled;
+    std::atomic<uint32_t> fChannels;
+    std::atomic<int> fResolution;
+    Axis fAxes[2];
+
+    double fSampleRate;
+    jack_nframes_t fCoefFrames;
+    float fCoef;
+
+    void output(Axis& axis, const float current, const jack_nframes_t time, const bool send, const uint32_t channels, const ControlResolution resolution)
+    {
+        axis.current.store(current, std::memory_order_relaxed);
+
+        const int control = axis.control.load(std::memory_order_relaxed);
+        ControlResolution axisResolution = resolution;
+        const int value = get_control_value(current, control, axisResolution);
+
+        // includes control and resolution, so changing those sends the value again
+        const int key = (value << 9) | (axisResolution << 7) | control;
+
+        if (key == axis.lastValue)
+            return;
+
+        axis.lastValue = key;
+
+        if (! send)
+            return;
+
+        for (int channel=0; channel < 16; ++channel)
+        {
+            if (channels & (1 << channel))
+                qMidiOutCC.put(channel, control, value, axisResolution, time);
+        }
+    }
+
+    XYSmoother(const XYSmoother&);
+    XYSmoother& operator=(const XYSmoother&);
+};
+
+// -------------------------------
+
+// Recorded cursor path of one pad, replayed in a loop.
+// The JACK thread records and plays it, the GUI only asks for a state, and loads or saves while stopped.
+// Points are kept in a buffer allocated once, a recording stops growing when it's full.
+//
+// Files are a FileHeader and then the points as they are in memory, host byte order,
+// so loading is a single read straight into the buffer.
+class XYAutomation
+{
+public:
+    enum State {
+        STATE_STOPPED   = 0,
+        STATE_RECORDING = 1,
+        STATE_PLAYING   = 2
+    };
+
+    struct Point {
+        uint32_t frame; // since the start of the recording
+        float x, y;     // -1..1
+    };
+
+    struct FileHeader {
+        char magic[4]; // "XYA1"
+        uint32_t count;
+        uint32_t length;
+        uint32_t sampleRate;
+    };
+
+    XYAutomation()
+        : fPoints(nullptr),
+          fCapacity(0),
+          fCount(0),
+          fLength(0),
+          fState(STATE_STOPPED),
+          fRequest(STATE_STOPPED),
+          fSync(false),
+          fFrame(0),
+          fIndex(0),
+          fLastX(0.0f),
+          fLastY(0.0f) {}
+
+    ~XYAutomation()
+    {
+        if (fPoints != nullptr)
+            delete[] fPoints;
+    }
+
+    // not RT-safe, call before the JACK client is activated
+    void setCapacity(const uint32_t points)
+    {
+        if (fPoints != nullptr)
+            delete[] fPoints;
+
+        fPoints   = new Point[points];
+        fCapacity = points;
+        fCount    = 0;
+        fLength   = 0;
+    }
+
+    // GUI thread, the JACK thread switches on its next period
+    void requestState(const State state)
+    {
+        fRequest.store(state, std::memory_order_release);
+    }
+
+    // the state the JACK thread is actually in
+    State getState() const
+    {
+        return State(fState.load(std::memory_order_acquire));
+    }
+
+    // playback follows the JACK transport position, and only while it rolls
+    void setSync(const bool sync)
+    {
+        fSync.store(sync, std::memory_order_relaxed);
+    }
+
+    // GUI thread, only while getState() is STATE_STOPPED
+
+    uint32_t getCount() const
+    {
+        return fCount;
+    }
+
+    bool load(const QString& filename, const uint32_t sampleRate)
+    {
+        Q_ASSERT(getState() == STATE_STOPPED);
+
+        QFile file(filename);
+
+        if (! file.open(QIODevice::ReadOnly))
+            return false;
+
+        FileHeader header;
+
+        if (file.read((char*)&header, sizeof(header)) != sizeof(header))
+            return false;
+        if (std::memcmp(header.magic, "XYA1", 4) != 0 || header.count > fCapacity || header.sampleRate == 0)
+            return false;
+
+        // whatever happens next, don't leave half a path around
+        fCount  = 0;
+        fLength = 0;
+
+        const qint64 size = qint64(header.count) * sizeof(Point);
+
+        if (file.read((char*)fPoints, size) != size)
+            return false;
+
+        for (uint32_t i=0; i < header.count; ++i)
+        {
+            if (fPoints[i].frame >= header.length || (i > 0 && fPoints[i].frame < fPoints[i-1].frame))
+                return false;
+        }
+
+        if (header.sampleRate != sampleRate)
+        {
+            for (uint32_t i=0; i < header.count; ++i)
+                fPoints[i].frame = uint64_t(fPoints[i].frame) * sampleRate / header.sampleRate;
+
+            header.length = uint64_t(header.length) * sampleRate / header.sampleRate;
+        }
+
+        fCount  = header.count;
+        fLength = header.length;
+        return true;
+    }
+
+    bool save(const QString& filename, const uint32_t sampleRate) const
+    {
+        Q_ASSERT(getState() == STATE_STOPPED);
+
+        QFile file(filename);
+
+        if (! file.open(QIODevice::WriteOnly|QIODevice::Truncate))
+            return false;
+
+        FileHeader header;
+        std::memcpy(header.magic, "XYA1", 4);
+        header.count      = fCount;
+        header.length     = fLength;
+        header.sampleRate = sampleRate;
+
+        const qint64 size = qint64(fCount) * sizeof(Point);
+
+        return (file.write((const char*)&header, sizeof(header)) == sizeof(header) &&
+                file.write((const char*)fPoints, size) == size);
+    }
+
+    // JACK thread, call at the start of every period before anything else
+    void update()
+    {
+        const int request = fRequest.load(std::memory_order_acquire);
+        const int state   = fState.load(std::memory_order_relaxed);
+
+        if (request == state)
+            return;
+
+        if (state == STATE_RECORDING)
+            fLength = (fCount != 0) ? fFrame : 0;
+
+        if (request == STATE_RECORDING)
+        {
+            fCount = 0;
+            fFrame = 0;
+        }
+        else if (request == STATE_PLAYING)
+        {
+            fFrame = 0;
+            fIndex = 0;
+        }
+
+        fState.store(request, std::memory_order_release);
+    }
+
+    // JACK thread, while recording; adds a point whenever the position changed
+    void record(const jack_nframes_t nframes, const float x, const float y)
+    {
+        if ((fCount == 0 || x != fLastX || y != fLastY) && fCount < fCapacity)
+        {
+            Point& point(fPoints[fCount++]);
+            point.frame = fFrame;
+            point.x = fLastX = x;
+            point.y = fLastY = y;
+        }
+
+        fFrame += nframes;
+    }
+
+    // JACK thread, while playing; returns true if a point falls in this period, with the last one in x, y and its offset
+    bool play(const jack_nframes_t nframes, const bool rolling, const jack_nframes_t transportFrame, float& x, float& y, jack_nframes_t& offset)
+    {
+        if (fCount == 0 || fLength == 0)
+            return false;
+
+        uint32_t frame = fFrame;
+
+        if (fSync.load(std::memory_order_relaxed))
+        {
+            if (! rolling)
+                return false;
+
+            frame = transportFrame % fLength;
+        }
+
+        // the transport moved, find the first point from here on
+        if (frame != fFrame)
+            fIndex = findPoint(frame);
+
+        bool found = false;
+
+        for (jack_nframes_t done = 0; done < nframes;)
+        {
+            const uint32_t end = (frame + (nframes - done) < fLength) ? frame + (nframes - done) : fLength;
+
+            for (; fIndex < fCount && fPoints[fIndex].frame < end; ++fIndex)
+            {
+                x = fPoints[fIndex].x;
+                y = fPoints[fIndex].y;
+                offset = done + (fPoints[fIndex].frame - frame);
+                found = true;
+            }
+
+            done += end - frame;
+            frame = end;
+
+            if (frame == fLength)
+            {
+                frame  = 0;
+                fIndex = 0;
+            }
+        }
+
+        fFrame = frame;
+        return found;
+    }
+
+private:
+    Point* fPoints;
+    uint32_t fCapacity;
+    uint32_t fCount;  // JACK thread while recording, GUI thread while stopped
+    uint32_t fLength; // loop length in frames
+
+    std::atomic<int>  fState;
+    std::atomic<int>  fRequest;
+    std::atomic<bool> fSync;
+
+    // JACK thread only
+    uint32_t fFrame; // record or play position
+    uint32_t fIndex; // next point to play
+    float fLastX, fLastY;
+
+    // first point at or after 'frame', no allocation and O(log n)
+    uint32_t findPoint(const uint32_t frame) const
+    {
+        uint32_t low = 0, high = fCount;
+
+        while (low < high)
+        {
+            const uint32_t middle = (low + high) / 2;
+
+            if (fPoints[middle].frame < frame)
+                low = middle + 1;
+            else
+                high = middle;
+        }
+
+        return low;
+    }
+
+    XYAutomation(const XYAutomation&);
+    XYAutomation& operator=(const XYAutomation&);
+};
+
+// -------------------------------
+
+// MIDI channels of a pad, 1-16
+static QList<int> get_settings_channels(QSettings& settings)
+{
+    QList<int> channels;
+
+    if (settings.contains("Channels"))
+    {
+        QVariantList varChannels = settings.value("Channels").toList();
+
+        foreach (const QVariant& var, varChannels)
+        {
+            bool ok;
+            int channel = var.toInt(&ok);
+
+            // hand-edited or old settings, anything else is not a MIDI channel
+            if (ok && channel >= 1 && channel <= 16 && ! channels.contains(channel))
+                channels.append(channel);
+        }
+    }
+    else
+    {
+#ifdef Q_COMPILER_INITIALIZER_LISTS
+        channels = { 1 };
+#else
+        channels << 1;
+#endif
+    }
+
+    return channels;
+}
+
+// one per pad, all run by the same process_callback
+static const int kMaxPads = 16;
+static XYSmoother gSmoothers[kMaxPads];
+static XYAutomation gAutomations[kMaxPads];
+static int gPadCount = 1;
+
+// CC updates per second, 0 sends them every JACK period; shared by all pads
+static const int kMaxRate = 1000;
+static int gMaxRateArg = -1; // from -maxrate, wins over the saved setting; -1 if not given
+
+static void set_max_rate(const int rate)
+{
+    qMidiOutCC.setInterval((rate > 0) ? jackbridge_get_sample_rate(jClient) / rate : 0);
+}
+
+static bool parse_max_rate(const QString& value)
+{
+    bool ok = false;
+    const int rate = value.toInt(&ok);
+
+    if (! ok || rate < 0 || rate > kMaxRate)
+        return false;
+
+    gMaxRateArg = rate;
+    return true;
+}
+
+// about 6 minutes of constant movement at 256 frames per period and 48 kHz, 768 KiB per pad
+static const uint32_t kAutomationPoints = 64*1024;
 
 QVector<QString> MIDI_CC_LIST;
 void MIDI_CC_LIST__init()
@@ -154,17 +730,18 @@ class XYGraphicsScene : public QGraphicsScene
     Q_OBJECT
 
 public:
-    XYGraphicsScene(QWidget* parent)
+    XYGraphicsScene(QWidget* parent, XYSmoother* smoother)
         : QGraphicsScene(parent),
+          m_smoother(smoother),
           m_parent(parent)
     {
         cc_x = 1;
         cc_y = 2;
 
+        m_resolution = CONTROL_7BIT;
+
         m_mouseLock = false;
         m_smooth    = false;
-        m_smooth_x  = 0.0f;
-        m_smooth_y  = 0.0f;
 
         setBackgroundBrush(Qt::black);
 
@@ -182,16 +759,25 @@ public:
     void setControlX(int x)
     {
         cc_x = x;
+        m_smoother->setControl(XYSmoother::kAxisX, x);
     }
 
     void setControlY(int y)
     {
         cc_y = y;
+        m_smoother->setControl(XYSmoother::kAxisY, y);
+    }
+
+    void setResolution(ControlResolution resolution)
+    {
+        m_resolution = resolution;
+        m_smoother->setResolution(resolution);
     }
 
     void setChannels(QList<int> channels)
     {
         m_channels = channels;
+        m_smoother->setChannels(channels);
     }
 
     void setPosX(float x, bool forward=true)
@@ -203,13 +789,12 @@ public:
         m_cursor->setPos(posX, m_cursor->y());
         m_lineV->setX(posX);
 
+        float value = posX / (p_size.x() + p_size.width());
+
         if (forward)
-        {
-            float value = posX / (p_size.x() + p_size.width());
             sendMIDI(&value, nullptr);
-        }
-        else
-            m_smooth_x = posX;
+
+        m_smoother->jump(XYSmoother::kAxisX, value);
     }
 
     void setPosY(float y, bool forward=true)
@@ -221,24 +806,28 @@ public:
         m_cursor->setPos(m_cursor->x(), posY);
         m_lineH->setY(posY);
 
+        float value = posY / (p_size.y() + p_size.height());
+
         if (forward)
-        {
-            float value = posY / (p_size.y() + p_size.height());
             sendMIDI(nullptr, &value);
-        }
-        else
-            m_smooth_y = posY;
+
+        m_smoother->jump(XYSmoother::kAxisY, value);
     }
 
     void setSmooth(bool smooth)
     {
         m_smooth = smooth;
+
+        // start from wherever the cursor is now
+        m_smoother->jump(XYSmoother::kAxisX, m_cursor->x() / (p_size.x() + p_size.width()));
+        m_smoother->jump(XYSmoother::kAxisY, m_cursor->y() / (p_size.y() + p_size.height()));
+        m_smoother->setEnabled(smooth);
     }
 
     void setSmoothValues(float x, float y)
     {
-        m_smooth_x = x * (p_size.x() + p_size.width());
-        m_smooth_y = y * (p_size.y() + p_size.height());
+        m_smoother->setTarget(XYSmoother::kAxisX, x);
+        m_smoother->setTarget(XYSmoother::kAxisY, y);
     }
 
     void handleCC(int param, int value)
@@ -284,26 +873,18 @@ public:
         p_size.setRect(-(float(size.width())/2), -(float(size.height())/2), size.width(), size.height());
     }
 
-    void updateSmooth()
+    // only shows where the JACK thread's ramp or playback is, the CCs are already sent from there
+    void updateSmooth(const bool playing)
     {
-        if (! m_smooth)
-            return;
-
-        if (m_cursor->x() == m_smooth_x && m_cursor->y() == m_smooth_y)
+        if (! (m_smooth || playing))
             return;
 
-        if (abs_f(m_cursor->x() - m_smooth_x) <= 0.0005f)
-            m_smooth_x = m_cursor->x();
-        if (abs_f(m_cursor->y() - m_smooth_y) <= 0.0005f)
-            m_smooth_y = m_cursor->y();
+        QPointF pos(m_smoother->getPosition(XYSmoother::kAxisX) * (p_size.x() + p_size.width()),
+                    m_smoother->getPosition(XYSmoother::kAxisY) * (p_size.y() + p_size.height()));
 
-        if (m_cursor->x() == m_smooth_x && m_cursor->y() == m_smooth_y)
+        if (m_cursor->pos() == pos)
             return;
 
-        float newX = float(m_smooth_x + m_cursor->x()*7) / 8;
-        float newY = float(m_smooth_y + m_cursor->y()*7) / 8;
-        QPointF pos(newX, newY);
-
         m_cursor->setPos(pos);
         m_lineH->setY(pos.y());
         m_lineV->setX(pos.x());
@@ -311,7 +892,6 @@ public:
         float xp = pos.x() / (p_size.x() + p_size.width());
         float yp = pos.y() / (p_size.y() + p_size.height());
 
-        sendMIDI(&xp, &yp);
         emit cursorMoved(xp, yp);
     }
 
@@ -331,10 +911,12 @@ protected:
                 pos.setY(p_size.y() + p_size.height());
         }
 
-        m_smooth_x = pos.x();
-        m_smooth_y = pos.y();
-
-        if (! m_smooth)
+        if (m_smooth)
+        {
+            m_smoother->setTarget(XYSmoother::kAxisX, pos.x() / (p_size.x() + p_size.width()));
+            m_smoother->setTarget(XYSmoother::kAxisY, pos.y() / (p_size.y() + p_size.height()));
+        }
+        else
         {
             m_cursor->setPos(pos);
             m_lineH->setY(pos.y());
@@ -345,26 +927,30 @@ protected:
 
             sendMIDI(&xp, &yp);
             emit cursorMoved(xp, yp);
+
+            // keeps the JACK side position current, for recording
+            m_smoother->jump(XYSmoother::kAxisX, xp);
+            m_smoother->jump(XYSmoother::kAxisY, yp);
         }
     }
 
     void sendMIDI(float* xp=nullptr, float* yp=nullptr)
     {
-        float rate = float(0xff) / 4;
-
         if (xp != nullptr)
-        {
-            int value = *xp * rate + rate;
-            foreach (const int& channel, m_channels)
-                qMidiOutData.put(0xB0 + channel - 1, cc_x, value);
-        }
+            sendControl(cc_x, *xp);
 
         if (yp != nullptr)
-        {
-            int value = *yp * rate + rate;
-            foreach (const int& channel, m_channels)
-                qMidiOutData.put(0xB0 + channel - 1, cc_y, value);
-        }
+            sendControl(cc_y, *yp);
+    }
+
+    void sendControl(int control, float pos)
+    {
+        ControlResolution resolution = m_resolution;
+        const int value = get_control_value(pos, control, resolution);
+
+        const jack_nframes_t time = midi_out_time();
+        foreach (const int& channel, m_channels)
+            qMidiOutCC.put(channel - 1, control, value, resolution, time);
     }
 
     void keyPressEvent(QKeyEvent* event)
@@ -406,10 +992,10 @@ private:
     int cc_y;
     QList<int> m_channels;
 
-    bool  m_mouseLock;
-    bool  m_smooth;
-    float m_smooth_x;
-    float m_smooth_y;
+    ControlResolution m_resolution;
+
+    bool m_mouseLock;
+    bool m_smooth;
 
     QGraphicsEllipseItem* m_cursor;
     QGraphicsLineItem* m_lineH;
@@ -417,6 +1003,8 @@ private:
 
     QRectF p_size;
 
+    XYSmoother* const m_smoother;
+
     // fake parent
     QWidget* const m_parent;
     QWidget* parent() const
@@ -437,19 +1025,30 @@ class XYControllerW : public QMainWindow
     Q_OBJECT
 
 public:
-    XYControllerW()
+    XYControllerW(const int pad)
         : QMainWindow(nullptr),
+          m_pad(pad),
           settings("Cadence", "XY-Controller"),
-          scene(this),
+          scene(this, &gSmoothers[pad]),
           ui(new Ui::XYControllerW)
     {
         ui->setupUi(this);
 
+        // the first pad keeps the settings of the single pad version
+        if (gPadCount > 1)
+        {
+            setWindowTitle(windowTitle() + QString(" - Pad %1").arg(pad+1));
+
+            if (pad > 0)
+                settings.beginGroup(QString("Pad%1").arg(pad+1));
+        }
+
         // -------------------------------------------------------------
         // Internal stuff
 
         cc_x = 1;
         cc_y = 2;
+        m_resolution = CONTROL_7BIT;
 
         // -------------------------------------------------------------
         // Set-up GUI stuff
@@ -469,6 +1068,30 @@ public:
             ui->cb_control_y->addItem(MIDI_CC);
         }
 
+        QActionGroup* const resolutionGroup(new QActionGroup(this));
+        resolutionGroup->addAction(ui->act_res_7bit);
+        resolutionGroup->addAction(ui->act_res_14bit);
+        resolutionGroup->addAction(ui->act_res_nrpn);
+
+        // the CC rate is shared, only the first pad shows it
+        ui->act_rate_0->setData(0);
+        ui->act_rate_1000->setData(1000);
+        ui->act_rate_500->setData(500);
+        ui->act_rate_200->setData(200);
+        ui->act_rate_100->setData(100);
+        ui->act_rate_50->setData(50);
+        ui->act_rate_25->setData(25);
+
+        QActionGroup* const rateGroup(new QActionGroup(this));
+
+        foreach (QAction* const action, ui->menu_MaxRate->actions())
+        {
+            if (! action->isSeparator())
+                rateGroup->addAction(action);
+        }
+
+        ui->menu_MaxRate->menuAction()->setVisible(m_pad == 0);
+
         // -------------------------------------------------------------
         // Load Settings
 
@@ -509,13 +1132,26 @@ public:
         connect(ui->act_ch_all, SIGNAL(triggered()), SLOT(slot_checkChannel_all()));
         connect(ui->act_ch_none, SIGNAL(triggered()), SLOT(slot_checkChannel_none()));
 
+        connect(ui->act_res_7bit, SIGNAL(triggered()), SLOT(slot_setResolution()));
+        connect(ui->act_res_14bit, SIGNAL(triggered()), SLOT(slot_setResolution()));
+        connect(ui->act_res_nrpn, SIGNAL(triggered()), SLOT(slot_setResolution()));
+
+        foreach (QAction* const action, rateGroup->actions())
+            connect(action, SIGNAL(triggered()), SLOT(slot_setMaxRate()));
+
+        connect(ui->act_auto_record, SIGNAL(triggered(bool)), SLOT(slot_automationRecord(bool)));
+        connect(ui->act_auto_play, SIGNAL(triggered(bool)), SLOT(slot_automationPlay(bool)));
+        connect(ui->act_auto_sync, SIGNAL(triggered(bool)), SLOT(slot_automationSync(bool)));
+        connect(ui->act_auto_load, SIGNAL(triggered()), SLOT(slot_automationLoad()));
+        connect(ui->act_auto_save, SIGNAL(triggered()), SLOT(slot_automationSave()));
+
         connect(ui->act_show_keyboard, SIGNAL(triggered(bool)), SLOT(slot_showKeyboard(bool)));
         connect(ui->act_about, SIGNAL(triggered()), SLOT(slot_about()));
 
         // -------------------------------------------------------------
         // Final stuff
 
-        m_midiInTimerId = startTimer(30);
+        m_smoothTimerId = startTimer(30);
         QTimer::singleShot(0, this, SLOT(slot_updateScreen()));
     }
 
@@ -531,17 +1167,36 @@ public:
         scene.setSmoothValues(float(dial_x) / 100, float(dial_y) / 100);
     }
 
+    // called by MidiInDispatcher for every incoming channel message, system ones never get here
+    void handleMidiIn(const unsigned char* const data, const uint32_t size)
+    {
+        int channel = (data[0] & 0x0F) + 1;
+        int mode    = data[0] & 0xF0;
+
+        if (! m_channels.contains(channel))
+            return;
+
+        if (mode == 0x80 && size >= 2)
+            ui->keyboard->sendNoteOff(data[1], false);
+        else if (mode == 0x90 && size >= 2)
+            ui->keyboard->sendNoteOn(data[1], false);
+        else if (mode == 0xB0 && size >= 3)
+            scene.handleCC(data[1], data[2]);
+    }
+
 protected slots:
     void slot_noteOn(int note)
     {
+        const jack_nframes_t time = midi_out_time();
         foreach (const int& channel, m_channels)
-            qMidiOutData.put(0x90 + channel - 1, note, 100);
+            qMidiOutData.put(0x90 + channel - 1, note, 100, time);
     }
 
     void slot_noteOff(int note)
     {
+        const jack_nframes_t time = midi_out_time();
         foreach (const int& channel, m_channels)
-            qMidiOutData.put(0x80 + channel - 1, note, 0);
+            qMidiOutData.put(0x80 + channel - 1, note, 0, time);
     }
 
     void slot_updateSceneX(int x)
@@ -662,6 +1317,27 @@ protected slots:
         scene.setSmooth(yesno);
     }
 
+    void slot_setResolution()
+    {
+        if (ui->act_res_nrpn->isChecked())
+            m_resolution = CONTROL_NRPN;
+        else if (ui->act_res_14bit->isChecked())
+            m_resolution = CONTROL_14BIT;
+        else
+            m_resolution = CONTROL_7BIT;
+
+        scene.setResolution(m_resolution);
+    }
+
+    void slot_setMaxRate()
+    {
+        if (! sender())
+            return;
+
+        m_maxRate = ((QAction*)sender())->data().toInt();
+        set_max_rate(m_maxRate);
+    }
+
     void slot_sceneCursorMoved(float xp, float yp)
     {
         ui->dial_x->blockSignals(true);
@@ -674,6 +1350,48 @@ protected slots:
         ui->dial_y->blockSignals(false);
     }
 
+    void slot_automationRecord(bool yesno)
+    {
+        ui->act_auto_play->setChecked(false);
+        gAutomations[m_pad].requestState(yesno ? XYAutomation::STATE_RECORDING : XYAutomation::STATE_STOPPED);
+    }
+
+    void slot_automationPlay(bool yesno)
+    {
+        ui->act_auto_record->setChecked(false);
+        gAutomations[m_pad].requestState(yesno ? XYAutomation::STATE_PLAYING : XYAutomation::STATE_STOPPED);
+    }
+
+    void slot_automationSync(bool yesno)
+    {
+        gAutomations[m_pad].setSync(yesno);
+    }
+
+    void slot_automationLoad()
+    {
+        QString filename(QFileDialog::getOpenFileName(this, tr("Load Automation"), QString(), tr("XY Automation (*.xya)")));
+
+        if (filename.isEmpty() || ! stopAutomation())
+            return;
+
+        if (! gAutomations[m_pad].load(filename, jackbridge_get_sample_rate(jClient)))
+            QMessageBox::critical(this, tr("Error"), tr("Could not load automation file '%1'").arg(filename));
+    }
+
+    void slot_automationSave()
+    {
+        QString filename(QFileDialog::getSaveFileName(this, tr("Save Automation"), QString(), tr("XY Automation (*.xya)")));
+
+        if (filename.isEmpty() || ! stopAutomation())
+            return;
+
+        if (! filename.endsWith(".xya"))
+            filename += ".xya";
+
+        if (! gAutomations[m_pad].save(filename, jackbridge_get_sample_rate(jClient)))
+            QMessageBox::critical(this, tr("Error"), tr("Could not save automation file '%1'").arg(filename));
+    }
+
     void slot_showKeyboard(bool yesno)
     {
         ui->scrollArea->setVisible(yesno);
@@ -694,6 +1412,21 @@ protected slots:
     }
 
 protected:
+    // the JACK thread must let go of the points before the GUI touches them, waits for at most a second
+    bool stopAutomation()
+    {
+        XYAutomation& automation(gAutomations[m_pad]);
+        automation.requestState(XYAutomation::STATE_STOPPED);
+
+        ui->act_auto_record->setChecked(false);
+        ui->act_auto_play->setChecked(false);
+
+        for (int i=0; i < 100 && automation.getState() != XYAutomation::STATE_STOPPED; ++i)
+            QThread::msleep(10);
+
+        return (automation.getState() == XYAutomation::STATE_STOPPED);
+    }
+
     void saveSettings()
     {
         QVariantList varChannelList;
@@ -708,6 +1441,12 @@ protected:
         settings.setValue("ControlX", cc_x);
         settings.setValue("ControlY", cc_y);
         settings.setValue("Channels", varChannelList);
+
+        if (m_pad == 0)
+            settings.setValue("MaxRate", m_maxRate);
+
+        settings.setValue("Resolution", int(m_resolution));
+        settings.setValue("AutomationSync", ui->act_auto_sync->isChecked());
     }
 
     void loadSettings()
@@ -730,30 +1469,38 @@ protected:
         scene.setControlX(cc_x);
         scene.setControlY(cc_y);
 
-        m_channels.clear();
+        int resolution = settings.value("Resolution", CONTROL_7BIT).toInt();
+
+        if (resolution == CONTROL_NRPN)
+            ui->act_res_nrpn->setChecked(true);
+        else if (resolution == CONTROL_14BIT)
+            ui->act_res_14bit->setChecked(true);
+        else
+            ui->act_res_7bit->setChecked(true);
+
+        slot_setResolution();
 
-        if (settings.contains("Channels"))
+        bool automationSync = settings.value("AutomationSync", false).toBool();
+        ui->act_auto_sync->setChecked(automationSync);
+        gAutomations[m_pad].setSync(automationSync);
+
+        // CC updates per second, 0 means once every JACK period; shared by all pads
+        if (m_pad == 0)
         {
-            QVariantList channels = settings.value("Channels").toList();
+            m_maxRate = (gMaxRateArg >= 0) ? gMaxRateArg : settings.value("MaxRate", 0).toInt();
+            set_max_rate(m_maxRate);
 
-            foreach (const QVariant& var, channels)
+            // a rate from the command line may not be in the menu, then nothing is checked
+            foreach (QAction* const action, ui->menu_MaxRate->actions())
             {
-                bool ok;
-                int channel = var.toInt(&ok);
-
-                if (ok)
-                    m_channels.append(channel);
+                if (! action->isSeparator())
+                    action->setChecked(action->data().toInt() == m_maxRate);
             }
         }
         else
-        {
-#ifdef Q_COMPILER_INITIALIZER_LISTS
-            m_channels = { 1 };
-#else
-            m_channels << 1;
-#endif
-        }
+            m_maxRate = 0;
 
+        m_channels = get_settings_channels(settings);
         scene.setChannels(m_channels);
 
         for (int i=0; i < MIDI_CC_LIST.size(); i++)
@@ -806,32 +1553,8 @@ protected:
 
     void timerEvent(QTimerEvent* event)
     {
-        if (event->timerId() == m_midiInTimerId)
-        {
-            if (! qMidiInData.isEmpty())
-            {
-                unsigned char d1, d2, d3;
-                qMidiInInternal.copyDataFrom(&qMidiInData);
-
-                while (qMidiInInternal.get(&d1, &d2, &d3, false))
-                {
-                    int channel = (d1 & 0x0F) + 1;
-                    int mode    = d1 & 0xF0;
-
-                    if (m_channels.contains(channel))
-                    {
-                        if (mode == 0x80)
-                            ui->keyboard->sendNoteOff(d2, false);
-                        else if (mode == 0x90)
-                            ui->keyboard->sendNoteOn(d2, false);
-                        else if (mode == 0xB0)
-                            scene.handleCC(d2, d3);
-                    }
-                }
-            }
-
-            scene.updateSmooth();
-        }
+        if (event->timerId() == m_smoothTimerId)
+            scene.updateSmooth(gAutomations[m_pad].getState() == XYAutomation::STATE_PLAYING);
 
         QMainWindow::timerEvent(event);
     }
@@ -849,23 +1572,84 @@ protected:
     }
 
 private:
+    const int m_pad;
+
     int cc_x;
     int cc_y;
     QList<int> m_channels;
 
-    int m_midiInTimerId;
+    ControlResolution m_resolution;
+
+    int m_maxRate;
+    int m_smoothTimerId;
 
     QSettings settings;
     XYGraphicsScene scene;
     Ui::XYControllerW* const ui;
-
-    Queue qMidiInInternal;
 };
 
 #include "xycontroller.moc"
 
 // -------------------------------
 
+// Takes MIDI In from the JACK thread and hands every event to all pads, each one picks its own channels
+class MidiInDispatcher : public QObject
+{
+public:
+    MidiInDispatcher(const QList<XYControllerW*>& pads)
+        : QObject(nullptr),
+          m_pads(pads)
+    {
+        startTimer(30);
+    }
+
+protected:
+    void timerEvent(QTimerEvent*)
+    {
+        // records are read in place
+        while (const MidiEventRecord* const record = qMidiInData.peek())
+        {
+            foreach (XYControllerW* const pad, m_pads)
+                pad->handleMidiIn(record->getData(), record->size);
+
+            qMidiInData.pop();
+        }
+    }
+
+private:
+    const QList<XYControllerW*> m_pads;
+};
+
+// -------------------------------
+
+// Output events were stamped by the GUI during the previous cycle, play them exactly one period later
+// so they keep their spacing instead of all landing on frame 0.
+// Late or early ones are clamped to this cycle, and offsets never go backwards as JACK requires.
+static jack_nframes_t get_event_offset(const jack_nframes_t time, const jack_nframes_t previousStart, const jack_nframes_t nframes, jack_nframes_t& lastOffset)
+{
+    const int32_t delta = int32_t(time - previousStart);
+    jack_nframes_t offset;
+
+    if (delta < 0)
+        offset = 0;
+    else if (delta >= int32_t(nframes))
+        offset = nframes - 1;
+    else
+        offset = jack_nframes_t(delta);
+
+    if (offset < lastOffset)
+        offset = lastOffset;
+
+    lastOffset = offset;
+    return offset;
+}
+
+static void write_short_event(void* const buffer, const MidiData& event, const jack_nframes_t offset)
+{
+    const unsigned char data[3] = { event.d1, event.d2, event.d3 };
+    jackbridge_midi_event_write(buffer, offset, data, 3);
+}
+
 int process_callback(const jack_nframes_t nframes, void*)
 {
     void* const midiInBuffer  = jackbridge_port_get_buffer(jMidiInPort, nframes);
@@ -874,46 +1658,90 @@ int process_callback(const jack_nframes_t nframes, void*)
     if (! (midiInBuffer && midiOutBuffer))
         return 1;
 
-    // MIDI In
-    jack_midi_event_t midiEvent;
-    uint32_t midiEventCount = jackbridge_midi_get_event_count(midiInBuffer);
+    // frame time of this cycle's first frame
+    const jack_nframes_t cycleStart = jackbridge_last_frame_time(jClient);
 
-    qMidiInData.lock();
+    // MIDI Out, cleared first since MIDI In passes events through to it
+    jackbridge_midi_clear_buffer(midiOutBuffer);
 
-    for (uint32_t i=0; i < midiEventCount; i++)
+    const jack_nframes_t previousStart = cycleStart - nframes;
+
+    jack_position_t transportPos;
+    const bool rolling = (jackbridge_transport_query(jClient, &transportPos) == JackTransportRolling);
+
+    for (int i=0; i < gPadCount; ++i)
     {
-        if (! jackbridge_midi_event_get(&midiEvent, midiInBuffer, i))
-            break;
+        XYAutomation& automation(gAutomations[i]);
+        automation.update();
 
-        if (midiEvent.size == 1)
-            qMidiInData.put(midiEvent.buffer[0], 0, 0, false);
-        else if (midiEvent.size == 2)
-            qMidiInData.put(midiEvent.buffer[0], midiEvent.buffer[1], 0, false);
-        else if (midiEvent.size >= 3)
-            qMidiInData.put(midiEvent.buffer[0], midiEvent.buffer[1], midiEvent.buffer[2], false);
+        // playback goes out at the recorded frame, smoothing at the start of the cycle,
+        // both through the same CC path as the GUI's values
+        if (automation.getState() == XYAutomation::STATE_PLAYING)
+        {
+            float x, y;
+            jack_nframes_t offset;
 
-        if (qMidiInData.isFull())
-            break;
+            if (automation.play(nframes, rolling, transportPos.frame, x, y, offset))
+                gSmoothers[i].setPosition(x, y, previousStart + offset);
+        }
+        else
+        {
+            gSmoothers[i].process(nframes, previousStart);
+
+            if (automation.getState() == XYAutomation::STATE_RECORDING)
+                automation.record(nframes, gSmoothers[i].getPosition(XYSmoother::kAxisX), gSmoothers[i].getPosition(XYSmoother::kAxisY));
+        }
     }
-    qMidiInData.unlock();
 
-    // MIDI Out
-    jackbridge_midi_clear_buffer(midiOutBuffer);
-    qMidiOutData.lock();
+    // notes queued by the GUI, all of them in one go; 'time' becomes the offset in this cycle
+    static MidiData noteEvents[Queue::kSize];
+    const uint32_t noteEventCount = qMidiOutData.drain(noteEvents, Queue::kSize);
+
+    jack_nframes_t lastOffset = 0;
+
+    for (uint32_t i=0; i < noteEventCount; ++i)
+        noteEvents[i].time = get_event_offset(noteEvents[i].time, previousStart, nframes, lastOffset);
+
+    // MIDI In, channel messages go to the GUI.
+    // System messages (SysEx, clock, transport) are passed through to MIDI Out right away at their own offset,
+    // merged with the notes so offsets still never go backwards.
+    // This is the only way SysEx reaches MIDI Out, the GUI itself never sends any.
+    jack_midi_event_t midiEvent;
+    const uint32_t midiEventCount = jackbridge_midi_get_event_count(midiInBuffer);
+    uint32_t note = 0;
 
-    if (! qMidiOutData.isEmpty())
+    for (uint32_t i=0; i < midiEventCount; i++)
     {
-        unsigned char d1, d2, d3, data[3];
+        if (! jackbridge_midi_event_get(&midiEvent, midiInBuffer, i))
+            break;
+
+        if (midiEvent.size == 0)
+            continue;
 
-        while (qMidiOutData.get(&d1, &d2, &d3, false))
+        if ((midiEvent.buffer[0] & 0xF0) != 0xF0)
         {
-            data[0] = d1;
-            data[1] = d2;
-            data[2] = d3;
-            jackbridge_midi_event_write(midiOutBuffer, 0, data, 3);
+            qMidiInData.put(midiEvent.buffer, midiEvent.size, cycleStart + midiEvent.time);
+            continue;
         }
+
+        for (; note < noteEventCount && noteEvents[note].time <= midiEvent.time; ++note)
+            write_short_event(midiOutBuffer, noteEvents[note], noteEvents[note].time);
+
+        jackbridge_midi_event_write(midiOutBuffer, midiEvent.time, midiEvent.buffer, midiEvent.size);
+
+        if (midiEvent.time > lastOffset)
+            lastOffset = midiEvent.time;
     }
-    qMidiOutData.unlock();
+
+    for (; note < noteEventCount; ++note)
+        write_short_event(midiOutBuffer, noteEvents[note], noteEvents[note].time);
+
+    // only the latest value of each CC, at most once per MaxRate interval
+    static MidiData ccEvents[ControlChangeCoalescer::kMaxEvents];
+    const uint32_t ccEventCount = qMidiOutCC.drain(ccEvents, ControlChangeCoalescer::kMaxEvents, nframes);
+
+    for (uint32_t i=0; i < ccEventCount; ++i)
+        write_short_event(midiOutBuffer, ccEvents[i], get_event_offset(ccEvents[i].time, previousStart, nframes, lastOffset));
 
     return 0;
 }
@@ -928,6 +1756,9 @@ void session_callback(jack_session_event_t* const event, void* const arg)
     QString filepath((char*)arg);
 #endif
 
+    if (gPadCount > 1)
+        filepath += QString(" -pads %1").arg(gPadCount);
+
     event->command_line = strdup(filepath.toUtf8().constData());
 
     jackbridge_session_reply(jClient, event);
@@ -941,8 +1772,141 @@ void session_callback(jack_session_event_t* const event, void* const arg)
 
 // -------------------------------
 
+static bool init_jack(const char* const sessionArg, QString& error)
+{
+#ifdef HAVE_JACKSESSION
+    jack_options_t jOptions = static_cast<jack_options_t>(JackNoStartServer|JackSessionID);
+#else
+    jack_options_t jOptions = static_cast<jack_options_t>(JackNoStartServer);
+#endif
+    jack_status_t jStatus;
+    jClient = jackbridge_client_open("XY-Controller", jOptions, &jStatus);
+
+    if (! jClient)
+    {
+        error = QString::fromStdString(jackbridge_status_get_error_string(jStatus));
+        return false;
+    }
+
+    jMidiInPort  = jackbridge_port_register(jClient, "midi_in", JACK_DEFAULT_MIDI_TYPE, JackPortIsInput, 0);
+    jMidiOutPort = jackbridge_port_register(jClient, "midi_out", JACK_DEFAULT_MIDI_TYPE, JackPortIsOutput, 0);
+
+    for (int i=0; i < gPadCount; ++i)
+    {
+        gSmoothers[i].setSampleRate(jackbridge_get_sample_rate(jClient));
+        gAutomations[i].setCapacity(kAutomationPoints);
+    }
+
+    jackbridge_set_process_callback(jClient, process_callback, nullptr);
+#ifdef HAVE_JACKSESSION
+    // headless mode has no application to quit
+    if (sessionArg != nullptr)
+        jackbridge_set_session_callback(jClient, session_callback, (void*)sessionArg);
+#else
+    Q_UNUSED(sessionArg);
+#endif
+    jackbridge_activate(jClient);
+
+    return true;
+}
+
+static void close_jack()
+{
+    jackbridge_deactivate(jClient);
+    jackbridge_client_close(jClient);
+    jClient = nullptr;
+}
+
+// -------------------------------
+// Headless playback
+
+#ifndef Q_OS_WIN
+static volatile bool x_quitNow = false;
+
+static void signal_handler(int)
+{
+    x_quitNow = true;
+}
+
+// plays an automation file with the first pad's settings, without any GUI
+static int run_headless(const QString& filename, const bool sync)
+{
+    QSettings settings("Cadence", "XY-Controller");
+    XYSmoother& smoother(gSmoothers[0]);
+
+    smoother.setControl(XYSmoother::kAxisX, settings.value("ControlX", 1).toInt());
+    smoother.setControl(XYSmoother::kAxisY, settings.value("ControlY", 2).toInt());
+    smoother.setChannels(get_settings_channels(settings));
+    smoother.setResolution(ControlResolution(settings.value("Resolution", CONTROL_7BIT).toInt()));
+
+    QString error;
+
+    if (! init_jack(nullptr, error))
+    {
+        qCritical("Could not connect to JACK: %s", error.toLocal8Bit().constData());
+        return 1;
+    }
+
+    set_max_rate((gMaxRateArg >= 0) ? gMaxRateArg : settings.value("MaxRate", 0).toInt());
+
+    XYAutomation& automation(gAutomations[0]);
+
+    if (! automation.load(filename, jackbridge_get_sample_rate(jClient)))
+    {
+        qCritical("Could not load automation file '%s'", filename.toLocal8Bit().constData());
+        close_jack();
+        return 1;
+    }
+
+    std::signal(SIGINT, signal_handler);
+    std::signal(SIGTERM, signal_handler);
+
+    automation.setSync(sync);
+    automation.requestState(XYAutomation::STATE_PLAYING);
+
+    while (! x_quitNow)
+        usleep(100000);
+
+    close_jack();
+    return 0;
+}
+#endif
+
+// -------------------------------
+
 int main(int argc, char* argv[])
 {
+    // no display on a headless box, check for playback mode before Qt tries to open one
+    const char* playFile = nullptr;
+    const char* maxRate = nullptr;
+    bool playSync = false;
+
+    for (int i=1; i < argc; ++i)
+    {
+        if (std::strcmp(argv[i], "-play") == 0 && i+1 < argc)
+            playFile = argv[++i];
+        else if (std::strcmp(argv[i], "-maxrate") == 0 && i+1 < argc)
+            maxRate = argv[++i];
+        else if (std::strcmp(argv[i], "-sync") == 0)
+            playSync = true;
+    }
+
+    if (playFile != nullptr)
+    {
+#ifdef Q_OS_WIN
+        qCritical("Headless playback is not available on this platform");
+        return 1;
+#else
+        if (maxRate != nullptr && ! parse_max_rate(QString::fromLocal8Bit(maxRate)))
+        {
+            qCritical("-maxrate needs a number between 0 and %i", kMaxRate);
+            return 1;
+        }
+
+        return run_headless(QString::fromLocal8Bit(playFile), playSync);
+#endif
+    }
+
     MIDI_CC_LIST__init();
 
 #ifdef Q_OS_WIN
@@ -955,42 +1919,65 @@ int main(int argc, char* argv[])
     app.setOrganizationName("Cadence");
     app.setWindowIcon(QIcon(":/scalable/cadence.svg"));
 
+    // several pads in one window each, sharing this JACK client
+    const QStringList args(app.arguments());
+    const int padsIndex = args.indexOf("-pads");
+
+    if (padsIndex >= 0)
+    {
+        bool ok = false;
+        const int pads = (padsIndex+1 < args.count()) ? args[padsIndex+1].toInt(&ok) : 0;
+
+        if (! ok || pads < 1 || pads > kMaxPads)
+        {
+            QMessageBox::critical(nullptr, app.translate("XY-Controller", "Error"),
+                                  app.translate("XY-Controller", "-pads needs a number between 1 and %1").arg(kMaxPads));
+            return 1;
+        }
+
+        gPadCount = pads;
+    }
+
+    // CC updates per second for this run, same as picking it in the menu
+    const int maxRateIndex = args.indexOf("-maxrate");
+
+    if (maxRateIndex >= 0 && ! parse_max_rate(args.value(maxRateIndex+1)))
+    {
+        QMessageBox::critical(nullptr, app.translate("XY-Controller", "Error"),
+                              app.translate("XY-Controller", "-maxrate needs a number between 0 and %1").arg(kMaxRate));
+        return 1;
+    }
+
     // JACK initialization
-    jack_status_t jStatus;
-#ifdef HAVE_JACKSESSION
-    jack_options_t jOptions = static_cast<jack_options_t>(JackNoStartServer|JackSessionID);
-#else
-    jack_options_t jOptions = static_cast<jack_options_t>(JackNoStartServer);
-#endif
-    jClient = jackbridge_client_open("XY-Controller", jOptions, &jStatus);
+    QString error;
 
-    if (! jClient)
+    if (! init_jack(argv[0], error))
     {
-        std::string errorString(jackbridge_status_get_error_string(jStatus));
         QMessageBox::critical(nullptr, app.translate("XY-Controller", "Error"), app.translate("XY-Controller",
                                                                                               "Could not connect to JACK, possible reasons:\n"
-                                                                                              "%1").arg(QString::fromStdString(errorString)));
+                                                                                              "%1").arg(error));
         return 1;
     }
 
-    jMidiInPort  = jackbridge_port_register(jClient, "midi_in", JACK_DEFAULT_MIDI_TYPE, JackPortIsInput, 0);
-    jMidiOutPort = jackbridge_port_register(jClient, "midi_out", JACK_DEFAULT_MIDI_TYPE, JackPortIsOutput, 0);
+    // Show GUI
+    QList<XYControllerW*> pads;
 
-    jackbridge_set_process_callback(jClient, process_callback, nullptr);
-#ifdef HAVE_JACKSESSION
-    jackbridge_set_session_callback(jClient, session_callback, argv[0]);
-#endif
-    jackbridge_activate(jClient);
+    for (int i=0; i < gPadCount; ++i)
+    {
+        XYControllerW* const pad(new XYControllerW(i));
+        pad->show();
+        pads.append(pad);
+    }
 
-    // Show GUI
-    XYControllerW gui;
-    gui.show();
+    MidiInDispatcher dispatcher(pads);
 
     // App-Loop
     int ret = app.exec();
 
-    jackbridge_deactivate(jClient);
-    jackbridge_client_close(jClient);
+    close_jack();
+
+    foreach (XYControllerW* const pad, pads)
+        delete pad;
 
     return ret;
 }